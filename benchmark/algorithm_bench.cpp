@@ -40,6 +40,33 @@ BENCHMARK(all_of<std_par>)->Name("all_of(std::execution::par)")->UseRealTime();
 
 ////////////////////////////////
 
+template <class ExecPolicy>
+void copy_if(benchmark::State& state) {
+    auto values = iota_vector<int>(arr_length);
+    std::vector<int> dest(arr_length);
+
+    auto pred = [] (const int& em) { return em % 2 == 0; };
+
+    for ([[maybe_unused]] auto _ : state) {
+        if constexpr (is_policy<ExecPolicy>::value) {
+            auto res = std::copy_if(policy<ExecPolicy>::get(), values.begin(), values.end(), dest.begin(), pred);
+            benchmark::DoNotOptimize(res);
+        } else {
+            auto res = std::copy_if(values.begin(), values.end(), dest.begin(), pred);
+            benchmark::DoNotOptimize(res);
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(copy_if<seq>)->Name("copy_if()")->UseRealTime();
+BENCHMARK(copy_if<poolstl_par>)->Name("copy_if(poolstl::par)")->UseRealTime();
+#ifdef POOLSTL_BENCH_STD_PAR
+BENCHMARK(copy_if<std_par>)->Name("copy_if(std::execution::par)")->UseRealTime();
+#endif
+
+////////////////////////////////
+
 template <class ExecPolicy>
 void find_if(benchmark::State& state) {
     auto values = iota_vector<int>(arr_length);
@@ -93,6 +120,58 @@ BENCHMARK(for_each<std_par>)->Name("for_each(std::execution::par)")->UseRealTime
 
 ////////////////////////////////
 
+template <class ExecPolicy>
+void merge(benchmark::State& state) {
+    auto source = random_vector<int>(arr_length / 10);
+    auto mid = source.begin() + (std::ptrdiff_t)(source.size() / 2);
+    std::sort(source.begin(), mid);
+    std::sort(mid, source.end());
+    std::vector<int> dest(source.size());
+
+    for ([[maybe_unused]] auto _ : state) {
+        if constexpr (is_policy<ExecPolicy>::value) {
+            auto res = std::merge(policy<ExecPolicy>::get(), source.begin(), mid, mid, source.end(), dest.begin());
+            benchmark::DoNotOptimize(res);
+        } else {
+            auto res = std::merge(source.begin(), mid, mid, source.end(), dest.begin());
+            benchmark::DoNotOptimize(res);
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(merge<seq>)->Name("merge()")->UseRealTime();
+BENCHMARK(merge<poolstl_par>)->Name("merge(poolstl::par)")->UseRealTime();
+#ifdef POOLSTL_BENCH_STD_PAR
+BENCHMARK(merge<std_par>)->Name("merge(std::execution::par)")->UseRealTime();
+#endif
+
+////////////////////////////////
+
+template <class ExecPolicy>
+void minmax_element(benchmark::State& state) {
+    auto values = random_vector<float>(arr_length);
+
+    for ([[maybe_unused]] auto _ : state) {
+        if constexpr (is_policy<ExecPolicy>::value) {
+            auto res = std::minmax_element(policy<ExecPolicy>::get(), values.begin(), values.end());
+            benchmark::DoNotOptimize(res);
+        } else {
+            auto res = std::minmax_element(values.begin(), values.end());
+            benchmark::DoNotOptimize(res);
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(minmax_element<seq>)->Name("minmax_element()")->UseRealTime();
+BENCHMARK(minmax_element<poolstl_par>)->Name("minmax_element(poolstl::par)")->UseRealTime();
+#ifdef POOLSTL_BENCH_STD_PAR
+BENCHMARK(minmax_element<std_par>)->Name("minmax_element(std::execution::par)")->UseRealTime();
+#endif
+
+////////////////////////////////
+
 template <class ExecPolicy>
 void partition(benchmark::State& state) {
     auto values = iota_vector<int>(arr_length);
@@ -122,6 +201,35 @@ BENCHMARK(partition<std_par>)->Name("partition(std::execution::par)")->UseRealTi
 
 ////////////////////////////////
 
+template <class ExecPolicy>
+void set_intersection(benchmark::State& state) {
+    auto source = random_vector<int>(arr_length / 10);
+    auto mid = source.begin() + (std::ptrdiff_t)(source.size() / 2);
+    std::sort(source.begin(), mid);
+    std::sort(mid, source.end());
+    std::vector<int> dest(source.size());
+
+    for ([[maybe_unused]] auto _ : state) {
+        if constexpr (is_policy<ExecPolicy>::value) {
+            auto res = std::set_intersection(policy<ExecPolicy>::get(), source.begin(), mid, mid, source.end(),
+                                             dest.begin());
+            benchmark::DoNotOptimize(res);
+        } else {
+            auto res = std::set_intersection(source.begin(), mid, mid, source.end(), dest.begin());
+            benchmark::DoNotOptimize(res);
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(set_intersection<seq>)->Name("set_intersection()")->UseRealTime();
+BENCHMARK(set_intersection<poolstl_par>)->Name("set_intersection(poolstl::par)")->UseRealTime();
+#ifdef POOLSTL_BENCH_STD_PAR
+BENCHMARK(set_intersection<std_par>)->Name("set_intersection(std::execution::par)")->UseRealTime();
+#endif
+
+////////////////////////////////
+
 template <class ExecPolicy>
 void sort(benchmark::State& state) {
     auto source = random_vector<int>(arr_length / 10);
@@ -172,6 +280,8 @@ void pluggable_sort(benchmark::State& state) {
         } else if constexpr (which_impl == 5) {
             // does not use poolSTL at all. Just for comparison against parallelized version.
             pdqsort(values.begin(), values.end());
+        } else if constexpr (which_impl == 6) {
+            poolstl::pluggable_samplesort(policy<ExecPolicy>::get(), values.begin(), values.end(), pdqsort);
         }
 
         benchmark::DoNotOptimize(values);
@@ -181,6 +291,7 @@ void pluggable_sort(benchmark::State& state) {
 
 //BENCHMARK(pluggable_sort<poolstl_par, 5>)->Name("pdqsort()")->UseRealTime(); // does not use poolSTL at all. Just for comparison against parallelized version.
 BENCHMARK(pluggable_sort<poolstl_par, 1>)->Name("pluggable_sort(poolstl::par, ..., pdqsort)")->UseRealTime(); // uses pdqsort
+BENCHMARK(pluggable_sort<poolstl_par, 6>)->Name("pluggable_samplesort(poolstl::par, ..., pdqsort)")->UseRealTime(); // uses pdqsort, O(n) extra memory
 //BENCHMARK(pluggable_sort<poolstl_par, 2>)->Name("pluggable_mergesort(poolstl::par, ..., pdqsort)")->UseRealTime(); // uses pdqsort and std::inplace_merge (O(n) extra memory)
 //BENCHMARK(pluggable_sort<poolstl_par, 3>)->Name("pluggable_mergesort(poolstl::par, ..., pdqsort, pipm_merge)")->UseRealTime(); // uses pdqsort and adapted_pipm_inplace_merge (slower, but O(1) extra memory)
 
@@ -207,3 +318,34 @@ BENCHMARK(transform<poolstl_par>)->Name("transform(poolstl::par)")->UseRealTime(
 #ifdef POOLSTL_BENCH_STD_PAR
 BENCHMARK(transform<std_par>)->Name("transform(std::execution::par)")->UseRealTime();
 #endif
+
+////////////////////////////////
+
+template <class ExecPolicy>
+void unique(benchmark::State& state) {
+    std::vector<int> source(arr_length);
+    for (std::size_t i = 0; i < source.size(); ++i) {
+        source[i] = (int)(i / 4);
+    }
+
+    for ([[maybe_unused]] auto _ : state) {
+        state.PauseTiming();
+        std::vector<int> values(source);
+        state.ResumeTiming();
+
+        if constexpr (is_policy<ExecPolicy>::value) {
+            auto res = std::unique(policy<ExecPolicy>::get(), values.begin(), values.end());
+            benchmark::DoNotOptimize(res);
+        } else {
+            auto res = std::unique(values.begin(), values.end());
+            benchmark::DoNotOptimize(res);
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(unique<seq>)->Name("unique()")->UseRealTime();
+BENCHMARK(unique<poolstl_par>)->Name("unique(poolstl::par)")->UseRealTime();
+#ifdef POOLSTL_BENCH_STD_PAR
+BENCHMARK(unique<std_par>)->Name("unique(std::execution::par)")->UseRealTime();
+#endif
@@ -0,0 +1,320 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by:
+// the BSD 2-clause license, the MIT license, or at your choosing the BSL-1.0 license found in the LICENSE.*.txt files.
+// SPDX-License-Identifier: BSD-2-Clause OR MIT OR BSL-1.0
+
+#ifndef POOLSTL_INTERNAL_POOLED_FUTURE_HPP
+#define POOLSTL_INTERNAL_POOLED_FUTURE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "task_thread_pool.hpp"
+#include "utils.hpp"
+
+namespace poolstl {
+    namespace internal {
+
+        /**
+         * Wait on `cv` until `done()` returns true. Meanwhile run queued tasks from `task_pool` on the calling thread.
+         *
+         * Helping is what lets a thread wait on the pool, including one of the pool's own workers, without
+         * deadlocking or idling a core.
+         *
+         * @param task_pool Pool to help. May be nullptr to only wait.
+         * @param lock Holds the mutex that guards the state read by `done`. Released while running tasks.
+         */
+        template <class Predicate>
+        void wait_helping(task_thread_pool::task_thread_pool* task_pool, std::unique_lock<std::mutex>& lock,
+                          std::condition_variable& cv, Predicate done) {
+            while (!done()) {
+                if (task_pool) {
+                    lock.unlock();
+                    bool ran = task_pool->run_pending_task();
+                    lock.lock();
+                    if (ran || done()) {
+                        continue;
+                    }
+                    // Nothing to help with right now. Sleep until notified, but poll in case new tasks are queued.
+                    cv.wait_for(lock, std::chrono::microseconds(100));
+                } else {
+                    cv.wait(lock);
+                }
+            }
+        }
+
+        /**
+         * Storage for a task's return value.
+         */
+        template <typename T>
+        class result_slot {
+        public:
+            result_slot() = default;
+            result_slot(const result_slot&) = delete;
+            result_slot& operator=(const result_slot&) = delete;
+            ~result_slot() { reset(); }
+
+            template <typename F>
+            void emplace_from(F& func) {
+                ::new (static_cast<void*>(&storage)) T(func());
+                has_value = true;
+            }
+
+            T& value() { return *reinterpret_cast<T*>(&storage); }
+
+            T take() {
+                T ret(std::move(*reinterpret_cast<T*>(&storage)));
+                reset();
+                return ret;
+            }
+
+            void reset() {
+                if (has_value) {
+                    reinterpret_cast<T*>(&storage)->~T();
+                    has_value = false;
+                }
+            }
+
+        protected:
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+            bool has_value = false;
+        };
+
+        template <>
+        class result_slot<void> {
+        public:
+            template <typename F>
+            void emplace_from(F& func) { func(); }
+            void take() {}
+            void reset() {}
+        };
+
+        /**
+         * Shared state between a pooled_task and its pooled_future.
+         *
+         * Instead of being freed, states are recycled through a per-thread free list. Once warmed up, submitting a
+         * task and waiting on its result does not allocate.
+         */
+        template <typename T>
+        class pooled_state {
+        public:
+            /**
+             * Get a state from the calling thread's free list, or allocate a new one if the list is empty.
+             * The returned state has two references: one for the task and one for the future.
+             *
+             * @param task_pool Pool that will run the task. Waiting on the result helps run this pool's tasks.
+             */
+            static pooled_state* acquire(task_thread_pool::task_thread_pool* task_pool) {
+                free_list& list = get_free_list();
+                pooled_state* state = list.head;
+                if (state) {
+                    list.head = state->next_free;
+                    --list.size;
+                } else {
+                    state = new pooled_state();
+                }
+                state->refs.store(2, std::memory_order_relaxed);
+                state->task_pool = task_pool;
+                return state;
+            }
+
+            /**
+             * Drop a reference. The last reference returns the state to the calling thread's free list.
+             */
+            void release() {
+                if (refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                    return;
+                }
+
+                ready = false;
+                exception = nullptr;
+                result.reset();
+
+                free_list& list = get_free_list();
+                if (list.size >= max_free_list_size) {
+                    delete this;
+                    return;
+                }
+                next_free = list.head;
+                list.head = this;
+                ++list.size;
+            }
+
+            /**
+             * Call func and store its result or exception, then wake up any waiting future.
+             */
+            template <typename F>
+            void run(F& func) {
+                try {
+                    result.emplace_from(func);
+                } catch (...) {
+                    exception = std::current_exception();
+                }
+                mark_ready();
+            }
+
+            /**
+             * Store an exception instead of a result, then wake up any waiting future.
+             */
+            void set_exception(std::exception_ptr e) {
+                exception = std::move(e);
+                mark_ready();
+            }
+
+            void wait() {
+                std::unique_lock<std::mutex> lock(mutex);
+                wait_helping(task_pool, lock, cv, [&] { return ready; });
+            }
+
+            T get() {
+                wait();
+                if (exception) {
+                    std::rethrow_exception(exception);
+                }
+                return result.take();
+            }
+
+        protected:
+            pooled_state() = default;
+
+            void mark_ready() {
+                // Notify with the lock held. The waiter cannot observe `ready`, return, and recycle this state
+                // until the lock is released, and nothing touches the state after that.
+                const std::lock_guard<std::mutex> lock(mutex);
+                ready = true;
+                cv.notify_all();
+            }
+
+            struct free_list {
+                free_list() = default;
+                free_list(const free_list&) = delete;
+                free_list& operator=(const free_list&) = delete;
+                ~free_list() {
+                    while (head) {
+                        pooled_state* next = head->next_free;
+                        delete head;
+                        head = next;
+                    }
+                }
+
+                pooled_state* head = nullptr;
+                std::size_t size = 0;
+            };
+
+            static free_list& get_free_list() {
+                static thread_local free_list list;
+                return list;
+            }
+
+            /**
+             * Cap on the number of idle states kept per thread.
+             */
+            static constexpr std::size_t max_free_list_size = 256;
+
+            std::mutex mutex;
+            std::condition_variable cv;
+            bool ready = false;
+            std::exception_ptr exception;
+            result_slot<T> result;
+            std::atomic<int> refs{0};
+            task_thread_pool::task_thread_pool* task_pool = nullptr;
+            pooled_state* next_free = nullptr;
+        };
+
+        /**
+         * Like std::future, but with a recycled shared state. See pooled_state.
+         */
+        template <typename T>
+        class pooled_future {
+        public:
+            pooled_future() = default;
+            explicit pooled_future(pooled_state<T>* state): state(state) {}
+            pooled_future(pooled_future&& other) noexcept : state(other.state) { other.state = nullptr; }
+            pooled_future& operator=(pooled_future&& other) noexcept {
+                if (this != &other) {
+                    release();
+                    state = other.state;
+                    other.state = nullptr;
+                }
+                return *this;
+            }
+            pooled_future(const pooled_future&) = delete;
+            pooled_future& operator=(const pooled_future&) = delete;
+            ~pooled_future() { release(); }
+
+            POOLSTL_NO_DISCARD bool valid() const { return state != nullptr; }
+
+            void wait() const { state->wait(); }
+
+            /**
+             * Wait for the result then return it or rethrow the task's exception. May only be called once.
+             */
+            T get() {
+                state_releaser releaser{state};
+                state = nullptr;
+                return releaser.state->get();
+            }
+
+        protected:
+            struct state_releaser {
+                pooled_state<T>* state;
+                ~state_releaser() { state->release(); }
+            };
+
+            void release() {
+                if (state) {
+                    state->release();
+                    state = nullptr;
+                }
+            }
+
+            pooled_state<T>* state = nullptr;
+        };
+
+        /**
+         * A task that runs a Callable and stores the result in a pooled_state.
+         *
+         * If destroyed without being run, for example by task_thread_pool::clear_task_queue(), the future
+         * receives a std::future_error with broken_promise.
+         */
+        template <typename T, typename F>
+        class pooled_task {
+        public:
+            pooled_task(pooled_state<T>* state, F&& func): state(state), func(std::move(func)) {}
+            pooled_task(pooled_task&& other) noexcept(std::is_nothrow_move_constructible<F>::value)
+                : state(other.state), func(std::move(other.func)) {
+                other.state = nullptr;
+            }
+            pooled_task(const pooled_task&) = delete;
+            pooled_task& operator=(const pooled_task&) = delete;
+
+            ~pooled_task() {
+                if (state) {
+                    state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+                    state->release();
+                }
+            }
+
+            void operator()() {
+                pooled_state<T>* s = state;
+                state = nullptr;
+                s->run(func);
+                s->release();
+            }
+
+        protected:
+            pooled_state<T>* state;
+            F func;
+        };
+    }
+}
+
+#endif
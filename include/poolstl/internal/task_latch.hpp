@@ -0,0 +1,326 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by:
+// the BSD 2-clause license, the MIT license, or at your choosing the BSL-1.0 license found in the LICENSE.*.txt files.
+// SPDX-License-Identifier: BSD-2-Clause OR MIT OR BSL-1.0
+
+#ifndef POOLSTL_INTERNAL_TASK_LATCH_HPP
+#define POOLSTL_INTERNAL_TASK_LATCH_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include "pooled_future.hpp"
+#include "task_thread_pool.hpp"
+
+namespace poolstl {
+    namespace internal {
+
+        /**
+         * Waits for a group of tasks using one atomic counter, and keeps the first exception thrown by any of them.
+         *
+         * Cheaper than one future per task: a finishing task only decrements the counter, and only the last one
+         * takes the lock to wake the waiter.
+         */
+        class task_latch {
+        public:
+            explicit task_latch(task_thread_pool::task_thread_pool* task_pool): task_pool(task_pool) {}
+            task_latch(const task_latch&) = delete;
+            task_latch& operator=(const task_latch&) = delete;
+
+            /**
+             * Expect `n` more count_down() calls. Must be called by the waiting thread, before wait().
+             */
+            void add(std::ptrdiff_t n = 1) {
+                count.fetch_add(n, std::memory_order_relaxed);
+            }
+
+            void count_down() {
+                if (count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    // Notify with the lock held, so the waiter cannot return and destroy the latch before we are done.
+                    const std::lock_guard<std::mutex> lock(mutex);
+                    done = true;
+                    cv.notify_all();
+                }
+            }
+
+            /**
+             * Keep `e` if no other exception has been kept yet.
+             */
+            void set_exception(std::exception_ptr e) {
+                if (!has_exception.exchange(true, std::memory_order_relaxed)) {
+                    exception = std::move(e);
+                }
+            }
+
+            /**
+             * Call func, keep its exception if it throws, then count down.
+             */
+            template <class F>
+            void run(F& func) {
+                try {
+                    func();
+                } catch (...) {
+                    set_exception(std::current_exception());
+                }
+                count_down();
+            }
+
+            /**
+             * Wait for every add() to be matched by a count_down(), helping the pool in the meantime.
+             * Then rethrow the kept exception, if any.
+             */
+            void wait() {
+                // drop the waiting thread's own count
+                count_down();
+
+                std::unique_lock<std::mutex> lock(mutex);
+                wait_helping(task_pool, lock, cv, [&] { return done; });
+                if (exception) {
+                    std::rethrow_exception(exception);
+                }
+            }
+
+        protected:
+            task_thread_pool::task_thread_pool* task_pool;
+
+            // Starts at 1 for the waiting thread, so it cannot reach 0 before wait().
+            std::atomic<std::ptrdiff_t> count{1};
+            std::atomic<bool> has_exception{false};
+            std::exception_ptr exception;
+            std::mutex mutex;
+            std::condition_variable cv;
+            bool done = false;
+        };
+
+        /**
+         * Fixed-capacity storage for per-chunk results, with each result on its own cache line so that chunks
+         * running on different threads do not contend when storing them.
+         */
+        template <typename T>
+        class chunk_results {
+        public:
+            static constexpr std::size_t cache_line_size = 64;
+
+            using slot_type = result_slot<T>;
+
+            /**
+             * Iterates over the stored results.
+             */
+            class iterator {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = T*;
+                using reference = T&;
+
+                iterator(unsigned char* p, std::size_t stride): p(p), stride(stride) {}
+
+                reference operator*() const { return reinterpret_cast<slot_type*>(p)->value(); }
+                pointer operator->() const { return &**this; }
+                iterator& operator++() { p += stride; return *this; }
+                iterator operator++(int) { iterator ret(*this); p += stride; return ret; }
+                bool operator==(const iterator& other) const { return p == other.p; }
+                bool operator!=(const iterator& other) const { return p != other.p; }
+
+            protected:
+                unsigned char* p;
+                std::size_t stride;
+            };
+
+            explicit chunk_results(std::size_t capacity)
+                : buffer(new unsigned char[capacity * stride + cache_line_size]), capacity(capacity) {
+                void* ptr = buffer.get();
+                std::size_t space = capacity * stride + cache_line_size;
+                slots = static_cast<unsigned char*>(std::align(cache_line_size, capacity * stride, ptr, space));
+                for (std::size_t i = 0; i < capacity; ++i) {
+                    ::new (static_cast<void*>(slots + i * stride)) slot_type();
+                }
+            }
+
+            chunk_results(chunk_results&& other) noexcept
+                : buffer(std::move(other.buffer)), slots(other.slots), capacity(other.capacity), used(other.used) {
+                other.slots = nullptr;
+                other.capacity = 0;
+                other.used = 0;
+            }
+
+            chunk_results(const chunk_results&) = delete;
+            chunk_results& operator=(const chunk_results&) = delete;
+
+            ~chunk_results() {
+                for (std::size_t i = 0; i < capacity; ++i) {
+                    slot(i).~slot_type();
+                }
+            }
+
+            /**
+             * Reserve the next slot. Called by the thread that creates the chunks.
+             */
+            std::size_t next_index() { return used++; }
+
+            /**
+             * Store func() in slot i.
+             */
+            template <typename F>
+            void emplace(std::size_t i, F& func) { slot(i).emplace_from(func); }
+
+            POOLSTL_NO_DISCARD std::size_t size() const { return used; }
+            iterator begin() { return iterator(slots, stride); }
+            iterator end() { return iterator(slots + used * stride, stride); }
+
+        protected:
+            static constexpr std::size_t stride =
+                (sizeof(slot_type) + cache_line_size - 1) / cache_line_size * cache_line_size;
+
+            slot_type& slot(std::size_t i) { return *reinterpret_cast<slot_type*>(slots + i * stride); }
+
+            std::unique_ptr<unsigned char[]> buffer;
+            unsigned char* slots = nullptr;
+            std::size_t capacity = 0;
+            std::size_t used = 0;
+        };
+
+        /**
+         * Chunks that return void have nothing to store.
+         */
+        template <>
+        class chunk_results<void> {
+        public:
+            explicit chunk_results(std::size_t) {}
+
+            std::size_t next_index() { return used++; }
+
+            template <typename F>
+            void emplace(std::size_t, F& func) { func(); }
+
+            POOLSTL_NO_DISCARD std::size_t size() const { return used; }
+
+        protected:
+            std::size_t used = 0;
+        };
+
+        /**
+         * A latch and the results of the chunks it waits on.
+         */
+        template <typename T>
+        struct chunk_job {
+            chunk_job(task_thread_pool::task_thread_pool* task_pool, std::size_t capacity)
+                : latch(task_pool), results(capacity) {}
+
+            task_latch latch;
+            chunk_results<T> results;
+        };
+
+        /**
+         * A task that runs one chunk and stores its result in a chunk_job.
+         *
+         * If destroyed without being run, for example by task_thread_pool::clear_task_queue(), the job fails with
+         * a std::future_error with broken_promise.
+         */
+        template <typename T, typename F>
+        class chunk_task {
+        public:
+            chunk_task(chunk_job<T>* job, std::size_t index, F&& func): job(job), index(index), func(std::move(func)) {}
+            chunk_task(chunk_task&& other) noexcept(std::is_nothrow_move_constructible<F>::value)
+                : job(other.job), index(other.index), func(std::move(other.func)) {
+                other.job = nullptr;
+            }
+            chunk_task(const chunk_task&) = delete;
+            chunk_task& operator=(const chunk_task&) = delete;
+
+            ~chunk_task() {
+                if (job) {
+                    job->latch.set_exception(
+                        std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+                    job->latch.count_down();
+                }
+            }
+
+            void operator()() {
+                chunk_job<T>* j = job;
+                job = nullptr;
+                runner r{j, index, func};
+                j->latch.run(r);
+            }
+
+        protected:
+            struct runner {
+                chunk_job<T>* job;
+                std::size_t index;
+                F& func;
+                void operator()() { job->results.emplace(index, func); }
+            };
+
+            chunk_job<T>* job;
+            std::size_t index;
+            F func;
+        };
+
+        /**
+         * The Callable shared by a batch of chunks submitted with task_thread_pool::submit_bulk().
+         * Task i runs the chunk returned by `make_chunk(i)` and stores its result at `first_index + i`.
+         *
+         * The pool destroys it once every task of the batch has run or been dropped. If any were dropped, for
+         * example by task_thread_pool::clear_task_queue(), the job fails with a std::future_error with
+         * broken_promise.
+         */
+        template <typename T, typename MakeChunk>
+        class chunk_batch {
+        public:
+            chunk_batch(chunk_job<T>* job, std::size_t first_index, std::size_t num_chunks, MakeChunk&& make_chunk)
+                : job(job), first_index(first_index), num_chunks(num_chunks), make_chunk(std::move(make_chunk)) {}
+            chunk_batch(chunk_batch&& other) noexcept(std::is_nothrow_move_constructible<MakeChunk>::value)
+                : job(other.job), first_index(other.first_index), num_chunks(other.num_chunks),
+                  make_chunk(std::move(other.make_chunk)) {
+                other.job = nullptr;
+            }
+            chunk_batch(const chunk_batch&) = delete;
+            chunk_batch& operator=(const chunk_batch&) = delete;
+
+            ~chunk_batch() {
+                if (!job) {
+                    return;
+                }
+                // Once all chunks have run the job may be gone, so only touch it for chunks that did not run.
+                for (std::size_t i = num_run.load(); i < num_chunks; ++i) {
+                    job->latch.set_exception(
+                        std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+                    job->latch.count_down();
+                }
+            }
+
+            void operator()(std::size_t i) {
+                num_run.fetch_add(1, std::memory_order_relaxed);
+                runner r{this, i};
+                job->latch.run(r);
+            }
+
+        protected:
+            struct runner {
+                chunk_batch* batch;
+                std::size_t i;
+                void operator()() {
+                    auto func = batch->make_chunk(i);
+                    batch->job->results.emplace(batch->first_index + i, func);
+                }
+            };
+
+            chunk_job<T>* job;
+            std::size_t first_index;
+            std::size_t num_chunks;
+            MakeChunk make_chunk;
+            std::atomic<std::size_t> num_run{0};
+        };
+    }
+}
+
+#endif
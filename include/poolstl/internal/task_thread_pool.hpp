@@ -92,13 +92,31 @@
 #define TASK_THREAD_POOL_VERSION_MINOR 0
 #define TASK_THREAD_POOL_VERSION_PATCH 10
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
+#include <new>
 #include <queue>
 #include <thread>
 #include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <fstream>
+#include <string>
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 // MSVC does not correctly set the __cplusplus macro by default, so we must read it from _MSVC_LANG
 // See https://devblogs.microsoft.com/cppblog/msvc-now-correctly-reports-__cplusplus/
@@ -124,8 +142,418 @@ namespace task_thread_pool {
     using decay_t = typename std::decay<T>::type;
 #endif
 
+    /**
+     * Tell the CPU that the calling thread is in a spin-wait loop.
+     */
+    inline void cpu_relax() {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+        _mm_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+        __builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+        __asm__ __volatile__("yield");
+#endif
+    }
+
+    /**
+     * How an idle worker thread waits for new tasks.
+     *
+     * The worker polls for a task `spin_count` times with cpu_relax() between polls, then `yield_count` times with
+     * std::this_thread::yield() between polls, then parks until it is notified. Work that arrives while a worker
+     * is still polling starts without a thread wake-up, at the cost of the CPU time spent polling.
+     */
+    struct idle_strategy {
+        /**
+         * @param spin_count Number of polls with a CPU pause in between.
+         * @param yield_count Number of polls with a yield in between, after spinning.
+         */
+        explicit idle_strategy(unsigned int spin_count = 2000, unsigned int yield_count = 20)
+            : spin_count(spin_count), yield_count(yield_count) {}
+
+        /**
+         * Park as soon as there is no work.
+         */
+        static idle_strategy park() {
+            return idle_strategy(0, 0);
+        }
+
+        unsigned int spin_count;
+        unsigned int yield_count;
+    };
+
+    /**
+     * Which CPUs the worker threads of a pool are pinned to.
+     *
+     * Pinning uses pthread_setaffinity_np() and is only supported on Linux. On other platforms workers are not
+     * pinned. compact() and scatter() only use CPUs that the thread creating the workers is allowed to run on.
+     */
+    class cpu_affinity {
+    public:
+        /**
+         * Do not pin workers. The OS is free to move them between CPUs.
+         */
+        cpu_affinity() = default;
+
+        /**
+         * Pin workers to neighboring CPUs: the hardware threads of one core, then the other cores of the same
+         * socket, before moving to the next socket. Workers share as much cache as possible.
+         */
+        static cpu_affinity compact() {
+            return cpu_affinity(placement::compact, std::vector<int>());
+        }
+
+        /**
+         * Spread workers out: one per core, alternating between sockets, before using a second hardware thread
+         * of any core. Workers get as much cache and memory bandwidth as possible.
+         */
+        static cpu_affinity scatter() {
+            return cpu_affinity(placement::scatter, std::vector<int>());
+        }
+
+        /**
+         * Pin worker i to `cpus[i % cpus.size()]`.
+         */
+        static cpu_affinity list(std::vector<int> cpus) {
+            return cpu_affinity(placement::list, std::move(cpus));
+        }
+
+        /**
+         * Choose a CPU for each worker.
+         *
+         * @param num_workers Number of worker threads.
+         * @return The CPU of each worker, or -1 for workers that are not to be pinned.
+         */
+        TTP_NODISCARD std::vector<int> assign(unsigned int num_workers) const {
+            std::vector<int> order = how == placement::list ? cpus : ordered_cpus(how);
+            std::vector<int> ret(num_workers, -1);
+            if (!order.empty()) {
+                for (unsigned int i = 0; i < num_workers; ++i) {
+                    ret[i] = order[i % order.size()];
+                }
+            }
+            return ret;
+        }
+
+    protected:
+        enum class placement { none, compact, scatter, list };
+
+        cpu_affinity(placement how, std::vector<int> cpus): how(how), cpus(std::move(cpus)) {}
+
+        /**
+         * @return The allowed CPUs in compact() or scatter() order. Empty if workers cannot be pinned.
+         */
+        static std::vector<int> ordered_cpus(placement how) {
+            std::vector<int> ret;
+#if defined(__linux__)
+            if (how != placement::compact && how != placement::scatter) {
+                return ret;
+            }
+            cpu_set_t allowed;
+            CPU_ZERO(&allowed);
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+                return ret;
+            }
+
+            struct location {
+                int cpu;
+                int package;
+                int core;
+                int core_rank;  // index of the core within its package
+                int smt_rank;   // index of the hardware thread within its core
+            };
+            std::vector<location> locations;
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed)) {
+                    locations.push_back({cpu, read_topology_id(cpu, "physical_package_id", 0),
+                                         read_topology_id(cpu, "core_id", cpu), 0, 0});
+                }
+            }
+
+            std::sort(locations.begin(), locations.end(), [](const location& a, const location& b) {
+                return a.package != b.package ? a.package < b.package :
+                       a.core != b.core ? a.core < b.core : a.cpu < b.cpu;
+            });
+            if (how == placement::scatter) {
+                for (std::size_t i = 1; i < locations.size(); ++i) {
+                    const location& prev = locations[i - 1];
+                    location& cur = locations[i];
+                    if (cur.package == prev.package) {
+                        const bool same_core = cur.core == prev.core;
+                        cur.core_rank = prev.core_rank + (same_core ? 0 : 1);
+                        cur.smt_rank = same_core ? prev.smt_rank + 1 : 0;
+                    }
+                }
+                std::stable_sort(locations.begin(), locations.end(), [](const location& a, const location& b) {
+                    return a.smt_rank != b.smt_rank ? a.smt_rank < b.smt_rank : a.core_rank < b.core_rank;
+                });
+            }
+
+            for (const location& loc : locations) {
+                ret.push_back(loc.cpu);
+            }
+#else
+            (void)how;
+#endif
+            return ret;
+        }
+
+#if defined(__linux__)
+        /**
+         * Read a CPU's topology attribute from sysfs.
+         */
+        static int read_topology_id(int cpu, const char* name, int fallback) {
+            std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+            int id;
+            if (in >> id) {
+                return id;
+            }
+            return fallback;
+        }
+#endif
+
+        placement how = placement::none;
+        std::vector<int> cpus;
+    };
+
+    /**
+     * A move-only wrapper for a zero-argument Callable, used as the task queue entry.
+     *
+     * Callables that fit in the inline buffer and are nothrow-movable are stored inline, so wrapping them
+     * does not allocate. Larger ones are moved to the heap.
+     */
+    class inline_task {
+    public:
+        inline_task() = default;
+
+        template <typename F, typename = typename std::enable_if<
+            !std::is_same<typename std::decay<F>::type, inline_task>::value>::type>
+        inline_task(F&& func) { // NOLINT(google-explicit-constructor)
+            using Fn = typename std::decay<F>::type;
+            emplace<Fn>(std::forward<F>(func), std::integral_constant<bool, fits_inline<Fn>::value>());
+        }
+
+        inline_task(inline_task&& other) noexcept {
+            take(other);
+        }
+
+        inline_task& operator=(inline_task&& other) noexcept {
+            if (this != &other) {
+                reset();
+                take(other);
+            }
+            return *this;
+        }
+
+        inline_task(const inline_task&) = delete;
+        inline_task& operator=(const inline_task&) = delete;
+
+        ~inline_task() {
+            reset();
+        }
+
+        /**
+         * @return true if this wraps a Callable.
+         */
+        explicit operator bool() const noexcept {
+            return ops != nullptr;
+        }
+
+        /**
+         * Call the wrapped Callable.
+         */
+        void operator()() {
+            ops->invoke(&storage);
+        }
+
+    private:
+        /**
+         * Size of the inline buffer. Large enough for a std::bind of a function pointer and a few iterators.
+         */
+        static constexpr std::size_t inline_capacity = 8 * sizeof(void*);
+
+        using storage_type = typename std::aligned_storage<inline_capacity>::type;
+
+        template <typename Fn>
+        struct fits_inline : std::integral_constant<bool,
+            sizeof(Fn) <= sizeof(storage_type) &&
+            alignof(storage_type) % alignof(Fn) == 0 &&
+            std::is_nothrow_move_constructible<Fn>::value> {};
+
+        /**
+         * Type-erased operations on the stored Callable.
+         */
+        struct operations {
+            void (*invoke)(void*);
+            void (*relocate)(void* dst, void* src);  // move-construct dst from src, then destroy src
+            void (*destroy)(void*);
+        };
+
+        template <typename Fn>
+        struct inline_operations {
+            static Fn& get(void* p) { return *static_cast<Fn*>(p); }
+            static void invoke(void* p) { get(p)(); }
+            static void relocate(void* dst, void* src) { ::new (dst) Fn(std::move(get(src))); get(src).~Fn(); }
+            static void destroy(void* p) { get(p).~Fn(); }
+            static const operations* table() {
+                static const operations ops = {&invoke, &relocate, &destroy};
+                return &ops;
+            }
+        };
+
+        template <typename Fn>
+        struct heap_operations {
+            static Fn*& get(void* p) { return *static_cast<Fn**>(p); }
+            static void invoke(void* p) { (*get(p))(); }
+            static void relocate(void* dst, void* src) { ::new (dst) Fn*(get(src)); }
+            static void destroy(void* p) { delete get(p); }
+            static const operations* table() {
+                static const operations ops = {&invoke, &relocate, &destroy};
+                return &ops;
+            }
+        };
+
+        template <typename Fn, typename F>
+        void emplace(F&& func, std::true_type /* fits inline */) {
+            ::new (static_cast<void*>(&storage)) Fn(std::forward<F>(func));
+            ops = inline_operations<Fn>::table();
+        }
+
+        template <typename Fn, typename F>
+        void emplace(F&& func, std::false_type /* fits inline */) {
+            ::new (static_cast<void*>(&storage)) Fn*(new Fn(std::forward<F>(func)));
+            ops = heap_operations<Fn>::table();
+        }
+
+        void take(inline_task& other) noexcept {
+            if (other.ops) {
+                other.ops->relocate(&storage, &other.storage);
+                ops = other.ops;
+                other.ops = nullptr;
+            }
+        }
+
+        void reset() noexcept {
+            if (ops) {
+                ops->destroy(&storage);
+                ops = nullptr;
+            }
+        }
+
+        storage_type storage;
+        const operations* ops = nullptr;
+    };
+
+    /**
+     * A bounded lock-free multi-producer multi-consumer FIFO queue of tasks.
+     *
+     * Each slot has a sequence number that tells whether the slot is ready to be written or read in the current
+     * lap around the ring. Producers and consumers claim a position with a compare-and-swap on tail or head,
+     * move the task in or out, then publish the slot by advancing its sequence number.
+     * After Dmitry Vyukov's bounded MPMC queue.
+     */
+    class mpmc_task_ring {
+    public:
+        /**
+         * @param capacity Number of slots. Must be a power of two.
+         */
+        explicit mpmc_task_ring(std::size_t capacity): slots(new slot[capacity]), mask(capacity - 1) {
+            for (std::size_t i = 0; i < capacity; ++i) {
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        mpmc_task_ring(const mpmc_task_ring&) = delete;
+        mpmc_task_ring& operator=(const mpmc_task_ring&) = delete;
+
+        /**
+         * Add a task to the back of the queue.
+         *
+         * @return true if the task was moved into the queue, false if the queue is full.
+         */
+        bool try_push(inline_task& task) {
+            std::size_t pos = tail.load(std::memory_order_relaxed);
+            slot* s;
+            while (true) {
+                s = &slots[pos & mask];
+                const std::size_t seq = s->sequence.load(std::memory_order_acquire);
+                const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq - pos);
+                if (diff == 0) {
+                    if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    // The slot still holds the task from the previous lap.
+                    return false;
+                } else {
+                    pos = tail.load(std::memory_order_relaxed);
+                }
+            }
+            s->task = std::move(task);
+            s->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Take the task at the front of the queue.
+         *
+         * @param may_take Called once the front task is visible and before it is claimed. If it returns false
+         *                 the task is left in the queue. Anything published before the task was pushed is
+         *                 visible to it.
+         * @return true if a task was moved into `task`, false if the queue is empty or may_take refused.
+         */
+        template <typename MayTake>
+        bool try_pop(inline_task& task, MayTake may_take) {
+            std::size_t pos = head.load(std::memory_order_relaxed);
+            slot* s;
+            while (true) {
+                s = &slots[pos & mask];
+                const std::size_t seq = s->sequence.load(std::memory_order_acquire);
+                const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+                if (diff == 0) {
+                    if (!may_take()) {
+                        return false;
+                    }
+                    if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    // Empty, or the producer of this slot has not published it yet.
+                    return false;
+                } else {
+                    pos = head.load(std::memory_order_relaxed);
+                }
+            }
+            task = std::move(s->task);
+            s->sequence.store(pos + mask + 1, std::memory_order_release);
+            return true;
+        }
+
+    protected:
+        static constexpr std::size_t cache_line_size = 64;
+
+        struct slot {
+            std::atomic<std::size_t> sequence{0};
+            inline_task task;
+        };
+
+        std::unique_ptr<slot[]> slots;
+        const std::size_t mask;
+
+        // Keep producers and consumers off each other's cache lines.
+        char pad0[cache_line_size] = {};
+        std::atomic<std::size_t> tail{0};
+        char pad1[cache_line_size - sizeof(std::atomic<std::size_t>)] = {};
+        std::atomic<std::size_t> head{0};
+        char pad2[cache_line_size - sizeof(std::atomic<std::size_t>)] = {};
+    };
+
     /**
      * A fast and lightweight thread pool that uses C++11 threads.
+     *
+     * Each worker thread owns a task deque. Tasks submitted by a worker thread are pushed onto that worker's own
+     * deque and popped newest-first by the owner, while idle workers steal the oldest tasks from other workers' deques.
+     * Tasks submitted from outside the pool go to a shared injection queue, a lock-free ring buffer that spills
+     * into a locked overflow queue when full.
      */
     class task_thread_pool {
     public:
@@ -134,8 +562,12 @@ namespace task_thread_pool {
          *
          * @param num_threads Number of worker threads. If 0 then number of threads is equal to the
          *                    number of physical cores on the machine, as given by std::thread::hardware_concurrency().
+         * @param idle How worker threads wait when there are no tasks.
+         * @param affinity Which CPUs worker threads are pinned to.
          */
-        explicit task_thread_pool(unsigned int num_threads = 0) {
+        explicit task_thread_pool(unsigned int num_threads = 0, idle_strategy idle = idle_strategy(),
+                                  cpu_affinity affinity = cpu_affinity())
+            : idle(idle), affinity(std::move(affinity)) {
             if (num_threads < 1) {
                 num_threads = std::thread::hardware_concurrency();
                 if (num_threads < 1) { num_threads = 1; }
@@ -143,6 +575,17 @@ namespace task_thread_pool {
             start_threads(num_threads);
         }
 
+        /**
+         * Create a task_thread_pool with worker threads pinned to CPUs.
+         *
+         * @param num_threads Number of worker threads. If 0 then number of threads is equal to the
+         *                    number of physical cores on the machine, as given by std::thread::hardware_concurrency().
+         * @param affinity Which CPUs worker threads are pinned to.
+         * @param idle How worker threads wait when there are no tasks.
+         */
+        task_thread_pool(unsigned int num_threads, cpu_affinity affinity, idle_strategy idle = idle_strategy())
+            : task_thread_pool(num_threads, idle, std::move(affinity)) {}
+
         /**
          * Finish all tasks left in the queue then shut down worker threads.
          * If the pool is currently paused then it is resumed.
@@ -159,8 +602,24 @@ namespace task_thread_pool {
          * Tasks already in progress continue executing.
          */
         void clear_task_queue() {
-            const std::lock_guard<std::mutex> tasks_lock(task_mutex);
-            tasks = {};
+            const std::lock_guard<std::recursive_mutex> threads_lock(thread_mutex);
+            {
+                inline_task task;
+                while (injection_ring.try_pop(task, []() { return true; })) {
+                    task = inline_task();
+                    --num_queued_tasks;
+                }
+                const std::lock_guard<std::mutex> tasks_lock(task_mutex);
+                num_queued_tasks -= injection_overflow.size();
+                num_overflow_tasks -= injection_overflow.size();
+                injection_overflow = {};
+            }
+            for (std::size_t i = 0; i < worker_queues.size(); ++i) {
+                worker_queue& queue = worker_queues[i];
+                const std::lock_guard<std::mutex> queue_lock(queue.mutex);
+                num_queued_tasks -= queue.tasks.size();
+                queue.tasks.clear();
+            }
         }
 
         /**
@@ -169,8 +628,7 @@ namespace task_thread_pool {
          * @return Number of tasks that have been enqueued but not yet started.
          */
         TTP_NODISCARD size_t get_num_queued_tasks() const {
-            const std::lock_guard<std::mutex> tasks_lock(task_mutex);
-            return tasks.size();
+            return num_queued_tasks;
         }
 
         /**
@@ -179,8 +637,7 @@ namespace task_thread_pool {
          * @return Approximate number of tasks currently being processed by worker threads.
          */
         TTP_NODISCARD size_t get_num_running_tasks() const {
-            const std::lock_guard<std::mutex> tasks_lock(task_mutex);
-            return num_inflight_tasks;
+            return static_cast<size_t>(num_inflight_tasks);
         }
 
         /**
@@ -189,8 +646,7 @@ namespace task_thread_pool {
          * @return Approximate number of tasks both enqueued and running.
          */
         TTP_NODISCARD size_t get_num_tasks() const {
-            const std::lock_guard<std::mutex> tasks_lock(task_mutex);
-            return tasks.size() + num_inflight_tasks;
+            return num_queued_tasks + static_cast<size_t>(num_inflight_tasks);
         }
 
         /**
@@ -199,37 +655,63 @@ namespace task_thread_pool {
          * @return Number of worker threads.
          */
         TTP_NODISCARD unsigned int get_num_threads() const {
+            return num_workers;
+        }
+
+        /**
+         * Get how worker threads wait when there are no tasks.
+         *
+         * @return The idle strategy given to the constructor.
+         */
+        TTP_NODISCARD idle_strategy get_idle_strategy() const {
+            return idle;
+        }
+
+        /**
+         * Get the CPU that each worker thread is pinned to.
+         *
+         * @return The CPU of each worker, indexed by worker. -1 for workers that are not pinned, including when
+         *         pinning is not supported or failed.
+         */
+        TTP_NODISCARD std::vector<int> get_worker_cpus() const {
             const std::lock_guard<std::recursive_mutex> threads_lock(thread_mutex);
-            return static_cast<unsigned int>(threads.size());
+            return std::vector<int>(worker_cpus.begin(), worker_cpus.begin() + num_workers);
         }
 
         /**
          * Set number of worker threads. Will start or stop worker threads as necessary.
          *
+         * New workers are started alongside the running ones. Removed workers finish the task they are running
+         * and the tasks in their own deque, then exit. Unless called from one of this pool's tasks, this waits for
+         * them to exit. Queued tasks are kept.
+         *
          * @param num_threads Number of worker threads. If 0 then number of threads is equal to the
          *                    number of physical cores on the machine, as given by std::thread::hardware_concurrency().
          * @return Previous number of worker threads.
          */
         unsigned int set_num_threads(unsigned int num_threads) {
-            const std::lock_guard<std::recursive_mutex> threads_lock(thread_mutex);
-            unsigned int previous_num_threads = get_num_threads();
+            unsigned int previous_num_threads;
+            {
+                const std::lock_guard<std::recursive_mutex> threads_lock(thread_mutex);
+                previous_num_threads = get_num_threads();
 
-            if (num_threads < 1) {
-                num_threads = std::thread::hardware_concurrency();
-                if (num_threads < 1) { num_threads = 1; }
-            }
+                if (num_threads < 1) {
+                    num_threads = std::thread::hardware_concurrency();
+                    if (num_threads < 1) { num_threads = 1; }
+                }
 
-            if (previous_num_threads <= num_threads) {
-                // expanding the thread pool
-                start_threads(num_threads - previous_num_threads);
-            } else {
-                // contracting the thread pool
-                stop_all_threads();
-                {
-                    const std::lock_guard<std::mutex> tasks_lock(task_mutex);
-                    pool_running = true;
+                if (previous_num_threads <= num_threads) {
+                    // expanding the thread pool
+                    start_threads(num_threads);
+                } else {
+                    // contracting the thread pool
+                    stop_threads(num_threads);
                 }
-                start_threads(num_threads);
+            }
+
+            // A task could be waiting on work that only a removed worker can finish.
+            if (previous_num_threads > num_threads && get_current_pool() != this) {
+                wait_for_removed_workers();
             }
 
             return previous_num_threads;
@@ -260,7 +742,6 @@ namespace task_thread_pool {
          * @return true if pause() has been called without an intervening unpause().
          */
         TTP_NODISCARD bool is_paused() const {
-            const std::lock_guard<std::mutex> tasks_lock(task_mutex);
             return pool_paused;
         }
 
@@ -298,13 +779,14 @@ namespace task_thread_pool {
         /**
          * Submit a zero-argument Callable for the pool to execute.
          *
+         * If called from one of this pool's worker threads the task is pushed onto that worker's own deque,
+         * else onto the shared injection queue.
+         *
          * @param func The Callable to execute. Can be a function, a lambda, std::packaged_task, std::function, etc.
          */
         template <typename F>
         void submit_detach(F&& func) {
-            const std::lock_guard<std::mutex> tasks_lock(task_mutex);
-            tasks.emplace(std::forward<F>(func));
-            task_cv.notify_one();
+            enqueue(inline_task(std::forward<F>(func)));
         }
 
         /**
@@ -314,9 +796,78 @@ namespace task_thread_pool {
          */
         template <typename F, typename... A>
         void submit_detach(F&& func, A&&... args) {
-            const std::lock_guard<std::mutex> tasks_lock(task_mutex);
-            tasks.emplace(std::bind(std::forward<F>(func), std::forward<A>(args)...));
-            task_cv.notify_one();
+            enqueue(inline_task(std::bind(std::forward<F>(func), std::forward<A>(args)...)));
+        }
+
+        /**
+         * Submit `n` tasks for the pool to execute. Task i calls `func(i)`.
+         *
+         * Cheaper than n calls to submit_detach(): the tasks are added to a worker's deque under one lock, or to
+         * the lock-free injection queue, and idle workers are woken with one notification.
+         *
+         * @param n Number of tasks.
+         * @param func Callable that takes a std::size_t. Moved into one copy that all the tasks share. The copy is
+         *             destroyed once every task has run or been dropped.
+         */
+        template <typename F>
+        void submit_bulk(std::size_t n, F&& func) {
+            if (n == 0) {
+                return;
+            }
+            using Fn = typename std::decay<F>::type;
+            const std::shared_ptr<Fn> shared = std::make_shared<Fn>(std::forward<F>(func));
+            enqueue_bulk(n, [&shared](std::size_t i) { return inline_task(bulk_task<Fn>{shared, i}); });
+        }
+
+        /**
+         * Run one queued task on the calling thread, if there is one.
+         *
+         * Lets a thread that is waiting on results from this pool help execute tasks instead of sleeping.
+         * Called from one of this pool's worker threads, it prefers that worker's own deque. Called from any
+         * other thread it takes from the injection queue or steals from a worker.
+         *
+         * Does nothing if the pool is paused.
+         *
+         * @return true if a task was run.
+         */
+        bool run_pending_task() {
+            const worker_identity& identity = this_thread_identity();
+            unsigned int worker_index = no_worker;
+            if (identity.pool == this) {
+                worker_index = identity.index;
+            }
+
+            inline_task task;
+            if (!pop_task(worker_index, task)) {
+                return false;
+            }
+            const current_pool_scope scope(this);
+            run_task(task);
+            return true;
+        }
+
+        /**
+         * Call a Callable on the calling thread as if it were one of this pool's tasks.
+         *
+         * For the duration of the call get_current_pool() returns this pool.
+         *
+         * @param func The Callable to execute.
+         */
+        template <typename F>
+        void run_inline(F&& func) {
+            const current_pool_scope scope(this);
+            std::forward<F>(func)();
+        }
+
+        /**
+         * Get the pool whose task the calling thread is executing.
+         *
+         * That is the pool of a worker thread, or the pool of a task run by run_pending_task() or run_inline().
+         *
+         * @return The pool, or nullptr if the calling thread is not executing a pool task.
+         */
+        TTP_NODISCARD static task_thread_pool* get_current_pool() {
+            return this_thread_identity().current_pool;
         }
 
         /**
@@ -325,7 +876,7 @@ namespace task_thread_pool {
         void wait_for_queued_tasks() {
             std::unique_lock<std::mutex> tasks_lock(task_mutex);
             notify_task_finish = true;
-            task_finished_cv.wait(tasks_lock, [&] { return tasks.empty(); });
+            task_finished_cv.wait(tasks_lock, [&] { return num_queued_tasks == 0; });
             notify_task_finish = false;
         }
 
@@ -335,67 +886,500 @@ namespace task_thread_pool {
         void wait_for_tasks() {
             std::unique_lock<std::mutex> tasks_lock(task_mutex);
             notify_task_finish = true;
-            task_finished_cv.wait(tasks_lock, [&] { return tasks.empty() && num_inflight_tasks == 0; });
+            task_finished_cv.wait(tasks_lock, [&] { return num_queued_tasks == 0 && num_inflight_tasks == 0; });
             notify_task_finish = false;
         }
 
     protected:
 
+        /**
+         * A worker thread's own task deque.
+         *
+         * The owner pushes and pops at the back. Other workers steal from the front.
+         */
+        struct worker_queue {
+            std::mutex mutex;
+            std::deque<inline_task> tasks;
+        };
+
+        /**
+         * The workers' deques, indexed by worker index.
+         *
+         * Grows in blocks of doubling size and never moves or frees a deque, so it can be read without a lock
+         * while set_num_threads() adds workers.
+         */
+        class worker_queue_table {
+        public:
+            /**
+             * @return Number of deques. All deques below this index can be read.
+             */
+            std::size_t size() const {
+                return num_queues.load(std::memory_order_acquire);
+            }
+
+            worker_queue& operator[](std::size_t index) const {
+                const std::size_t block = block_of(index);
+                return blocks[block][index + 1 - ((std::size_t)1 << block)];
+            }
+
+            /**
+             * Make sure there are at least `n` deques. Must not be called concurrently with itself.
+             */
+            void grow(std::size_t n) {
+                const std::size_t old_size = num_queues.load(std::memory_order_relaxed);
+                for (std::size_t index = old_size; index < n; ++index) {
+                    const std::size_t block = block_of(index);
+                    if (!blocks[block]) {
+                        blocks[block].reset(new worker_queue[(std::size_t)1 << block]);
+                    }
+                }
+                if (n > old_size) {
+                    num_queues.store(n, std::memory_order_release);
+                }
+            }
+
+        private:
+            /**
+             * Block `b` holds the 2^b deques starting at index 2^b - 1.
+             */
+            static std::size_t block_of(std::size_t index) {
+                std::size_t block = 0;
+                while ((index + 1) >> (block + 1)) {
+                    ++block;
+                }
+                return block;
+            }
+
+            std::unique_ptr<worker_queue[]> blocks[sizeof(std::size_t) * 8];
+            std::atomic<std::size_t> num_queues{0};
+        };
+
+        /**
+         * One task of a submit_bulk() call.
+         */
+        template <typename Fn>
+        struct bulk_task {
+            std::shared_ptr<Fn> func;
+            std::size_t index;
+
+            void operator()() { (*func)(index); }
+        };
+
+        /**
+         * Identifies the pool that the current thread is a worker of, if any.
+         */
+        struct worker_identity {
+            task_thread_pool* pool = nullptr;
+            unsigned int index = 0;
+
+            // Pool whose task this thread is running. See get_current_pool().
+            task_thread_pool* current_pool = nullptr;
+        };
+
+        /**
+         * Sets the calling thread's current pool for the lifetime of the scope.
+         */
+        class current_pool_scope {
+        public:
+            explicit current_pool_scope(task_thread_pool* pool): previous(this_thread_identity().current_pool) {
+                this_thread_identity().current_pool = pool;
+            }
+            ~current_pool_scope() {
+                this_thread_identity().current_pool = previous;
+            }
+            current_pool_scope(const current_pool_scope&) = delete;
+            current_pool_scope& operator=(const current_pool_scope&) = delete;
+
+        private:
+            task_thread_pool* previous;
+        };
+
+        /**
+         * @return the identity of the calling thread.
+         */
+        static worker_identity& this_thread_identity() {
+            static thread_local worker_identity identity;
+            return identity;
+        }
+
+        /**
+         * Worker index used by pop_task() for threads that are not one of this pool's workers.
+         */
+        static constexpr unsigned int no_worker = static_cast<unsigned int>(-1);
+
+        /**
+         * Add a task to the calling worker's own deque, or the injection queue if not called from a worker.
+         */
+        void enqueue(inline_task&& task) {
+            enqueue_bulk(1, [&task](std::size_t) { return std::move(task); });
+        }
+
+        /**
+         * Add the `n` tasks returned by `make_task(i)` like enqueue(), then wake idle workers once.
+         */
+        template <typename MakeTask>
+        void enqueue_bulk(std::size_t n, MakeTask make_task) {
+            const worker_identity& identity = this_thread_identity();
+            if (identity.pool == this) {
+                worker_queue& own = worker_queues[identity.index];
+                const std::lock_guard<std::mutex> queue_lock(own.mutex);
+                for (std::size_t i = 0; i < n; ++i) {
+                    own.tasks.emplace_back(make_task(i));
+                    ++num_queued_tasks;
+                }
+            } else {
+                // Count first so the counter never drops below the number of tasks that can be popped.
+                num_queued_tasks += n;
+                std::size_t i = 0;
+                try {
+                    for (; i < n; ++i) {
+                        inline_task task(make_task(i));
+                        inject(task);
+                    }
+                } catch (...) {
+                    num_queued_tasks -= n - i;
+                    throw;
+                }
+            }
+
+            // A sleeping worker registers itself in num_idle_workers before its last check of num_queued_tasks,
+            // so either it sees the new tasks or we see it and must wake it.
+            if (num_idle_workers > 0) {
+                const std::lock_guard<std::mutex> tasks_lock(task_mutex);
+                if (n == 1) {
+                    task_cv.notify_one();
+                } else {
+                    task_cv.notify_all();
+                }
+            }
+        }
+
+        /**
+         * Add a task to the injection queue. Does not count it in num_queued_tasks.
+         *
+         * Goes to the overflow queue if the ring is full, and also while the overflow queue is not empty so
+         * that injected tasks stay roughly in submission order.
+         */
+        void inject(inline_task& task) {
+            if (num_overflow_tasks == 0 && injection_ring.try_push(task)) {
+                return;
+            }
+            const std::lock_guard<std::mutex> tasks_lock(task_mutex);
+            injection_overflow.emplace(std::move(task));
+            ++num_overflow_tasks;
+        }
+
+        /**
+         * Find a task to execute. Looks at the worker's own deque, then the injection queue,
+         * then steals from other workers.
+         *
+         * @param worker_index Index of the calling worker, or no_worker if not called from one of this pool's workers.
+         * @return true if a task was found and moved into `task`.
+         */
+        bool pop_task(unsigned int worker_index, inline_task& task) {
+            if (!pool_running || pool_paused || num_queued_tasks == 0) {
+                return false;
+            }
+
+            // pool_paused is checked again with each queue's lock held. A task pushed after pause() returned
+            // can then only be seen together with the pause.
+
+            const std::size_t num_queues = worker_queues.size();
+            worker_queue* own = worker_index < num_queues ? &worker_queues[worker_index] : nullptr;
+
+            // Own deque, newest first.
+            if (own && pop_own_task(*own, task)) {
+                return true;
+            }
+
+            // Injection queue, oldest first. The ring checks pool_paused once the task is visible, which is the
+            // same guarantee as checking it under a lock.
+            if (injection_ring.try_pop(task, [this]() { return !pool_paused; })) {
+                mark_task_started();
+                return true;
+            }
+            if (num_overflow_tasks > 0) {
+                const std::lock_guard<std::mutex> tasks_lock(task_mutex);
+                if (!injection_overflow.empty() && !pool_paused) {
+                    task = std::move(injection_overflow.front());
+                    injection_overflow.pop();
+                    --num_overflow_tasks;
+                    mark_task_started();
+                    return true;
+                }
+            }
+
+            // Steal from other workers, oldest first.
+            const std::size_t first_victim = own ? worker_index + 1 : 0;
+            for (std::size_t i = 0; i < num_queues; ++i) {
+                worker_queue& victim = worker_queues[(first_victim + i) % num_queues];
+                if (&victim == own) {
+                    continue;
+                }
+                const std::lock_guard<std::mutex> queue_lock(victim.mutex);
+                if (!victim.tasks.empty() && !pool_paused) {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    mark_task_started();
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /**
+         * Pop the newest task from a worker's own deque.
+         *
+         * @return true if a task was found and moved into `task`.
+         */
+        bool pop_own_task(worker_queue& own, inline_task& task) {
+            const std::lock_guard<std::mutex> queue_lock(own.mutex);
+            if (!own.tasks.empty() && !pool_paused) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                mark_task_started();
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * Update counters for a task that was just removed from a queue.
+         */
+        void mark_task_started() {
+            // Increment first so that wait_for_tasks() never sees both counters at zero while a task is in flight.
+            ++num_inflight_tasks;
+            --num_queued_tasks;
+        }
+
+        /**
+         * Execute a task returned by pop_task(), destroy it, then count it as finished.
+         */
+        void run_task(inline_task& task) {
+            try {
+                task();
+            } catch (...) {
+                // A detached task threw, or std::packaged_task::operator() threw in some error condition
+                // such as if the task had already been run. Nothing that the pool can do anything about.
+            }
+            task = inline_task();
+
+            --num_inflight_tasks;
+            if (notify_task_finish) {
+                const std::lock_guard<std::mutex> tasks_lock(task_mutex);
+                task_finished_cv.notify_all();
+            }
+        }
+
         /**
          * Main function for worker threads.
          */
-        void worker_main() {
-            bool finished_task = false;
+        void worker_main(unsigned int worker_index, int cpu) {
+            if (cpu >= 0) {
+                // Pin before running any task, then report back to start_threads().
+                const bool pinned = pin_this_thread(cpu);
+                const std::lock_guard<std::mutex> tasks_lock(task_mutex);
+                if (!pinned) {
+                    worker_cpus[worker_index] = -1;
+                }
+                --num_pinning_workers;
+                workers_cv.notify_all();
+            }
+
+            worker_identity& identity = this_thread_identity();
+            identity.pool = this;
+            identity.index = worker_index;
+            identity.current_pool = this;
 
             while (true) {
-                std::unique_lock<std::mutex> tasks_lock(task_mutex);
+                if (worker_index >= num_workers) {
+                    // Removed by set_num_threads(). Finish our own deque, then exit.
+                    inline_task task;
+                    if (pop_own_task(worker_queues[worker_index], task)) {
+                        run_task(task);
+                        continue;
+                    }
+                    if (retire_worker(worker_index)) {
+                        break;
+                    }
+                }
 
-                if (finished_task) {
-                    --num_inflight_tasks;
-                    if (notify_task_finish) {
-                        task_finished_cv.notify_all();
+                {
+                    inline_task task;
+                    if (pop_task(worker_index, task)) {
+                        run_task(task);
+                        continue;
                     }
                 }
 
-                task_cv.wait(tasks_lock, [&]() { return !pool_running || (!pool_paused && !tasks.empty()); });
+                if (poll_for_tasks(worker_index)) {
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> tasks_lock(task_mutex);
+                ++num_idle_workers;
+                task_cv.wait(tasks_lock, [&]() {
+                    return !pool_running || worker_index >= num_workers || (!pool_paused && num_queued_tasks > 0);
+                });
+                --num_idle_workers;
 
                 if (!pool_running) {
                     break;
                 }
+            }
 
-                // Must mean that (!pool_paused && !tasks.empty()) is true
+            identity = worker_identity();
+        }
 
-                std::packaged_task<void()> task{std::move(tasks.front())};
-                tasks.pop();
-                ++num_inflight_tasks;
-                tasks_lock.unlock();
+        /**
+         * Poll for a task to become available as configured by the idle strategy.
+         *
+         * @return true if there may be a task to run or the worker was removed, false if the worker should park.
+         */
+        bool poll_for_tasks(unsigned int worker_index) const {
+            const unsigned int num_polls = idle.spin_count + idle.yield_count;
+            for (unsigned int i = 0; i < num_polls; ++i) {
+                if (!pool_running) {
+                    return false;
+                }
+                if (worker_index >= num_workers || (!pool_paused && num_queued_tasks > 0)) {
+                    return true;
+                }
+                if (i < idle.spin_count) {
+                    cpu_relax();
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            return false;
+        }
 
-                try {
-                    task();
-                } catch (...) {
-                    // std::packaged_task::operator() may throw in some error conditions, such as if the task
-                    // had already been run. Nothing that the pool can do anything about.
+        /**
+         * Start worker threads until there are `num_threads`.
+         *
+         * A removed worker that has not exited yet is kept instead of replaced.
+         *
+         * @param num_threads How many threads to have. Must not be less than num_workers.
+         */
+        void start_threads(const unsigned int num_threads) {
+            const std::lock_guard<std::recursive_mutex> threads_lock(thread_mutex);
+
+            worker_queues.grow(num_threads);
+            if (threads.size() < num_threads) {
+                threads.resize(num_threads);
+                worker_cpus.resize(num_threads, -1);
+            }
+            const std::vector<int> cpus = affinity.assign(num_threads);
+
+            std::vector<unsigned int> new_workers;
+            {
+                const std::lock_guard<std::mutex> tasks_lock(task_mutex);
+                worker_running.resize(threads.size(), false);
+                for (unsigned int i = num_workers; i < num_threads; ++i) {
+                    if (!worker_running[i]) {
+                        worker_running[i] = true;
+                        new_workers.push_back(i);
+                        if (cpus[i] >= 0) {
+                            ++num_pinning_workers;
+                        }
+                    }
                 }
+                // Removed workers that are still running see this and keep going.
+                num_workers = num_threads;
+            }
 
-                finished_task = true;
+            for (unsigned int i : new_workers) {
+                // The previous worker in this slot has already exited.
+                if (threads[i].joinable()) {
+                    threads[i].join();
+                }
+                worker_cpus[i] = cpus[i];
+                threads[i] = std::thread(&task_thread_pool::worker_main, this, i, cpus[i]);
             }
+
+            // Each worker pins itself, so wait until they have all tried before get_worker_cpus() can be called.
+            std::unique_lock<std::mutex> tasks_lock(task_mutex);
+            workers_cv.wait(tasks_lock, [&]() { return num_pinning_workers == 0; });
         }
 
         /**
-         * Start worker threads.
+         * Remove workers until there are `num_threads`. Removed workers exit once their own deque is empty.
          *
-         * @param num_threads How many threads to start.
+         * @param num_threads How many threads to keep. Must not be more than num_workers.
          */
-        void start_threads(const unsigned int num_threads) {
+        void stop_threads(const unsigned int num_threads) {
             const std::lock_guard<std::recursive_mutex> threads_lock(thread_mutex);
+            const std::lock_guard<std::mutex> tasks_lock(task_mutex);
+            num_workers = num_threads;
+            task_cv.notify_all();
+        }
+
+        /**
+         * Wait until every removed worker has exited. Their threads are joined later by start_threads() or
+         * stop_all_threads().
+         */
+        void wait_for_removed_workers() {
+            std::unique_lock<std::mutex> tasks_lock(task_mutex);
+            workers_cv.wait(tasks_lock, [&]() {
+                for (std::size_t i = num_workers; i < worker_running.size(); ++i) {
+                    if (worker_running[i]) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+        }
 
-            for (unsigned int i = 0; i < num_threads; ++i) {
-                threads.emplace_back(&task_thread_pool::worker_main, this);
+        /**
+         * Called by a removed worker once its own deque is empty or the pool is paused. Moves any tasks left in the
+         * worker's deque to the injection queue.
+         *
+         * @return true if the worker should exit, false if set_num_threads() added it back in the meantime.
+         */
+        bool retire_worker(unsigned int worker_index) {
+            {
+                worker_queue& own = worker_queues[worker_index];
+                const std::lock_guard<std::mutex> queue_lock(own.mutex);
+                for (auto& task : own.tasks) {
+                    inject(task);
+                }
+                own.tasks.clear();
+            }
+
+            const std::lock_guard<std::mutex> tasks_lock(task_mutex);
+            if (worker_index < num_workers) {
+                return false;
             }
+            worker_running[worker_index] = false;
+            workers_cv.notify_all();
+            return true;
+        }
+
+        /**
+         * Pin the calling thread to one CPU.
+         *
+         * @return true on success.
+         */
+        static bool pin_this_thread(int cpu) {
+#if defined(__linux__)
+            if (cpu >= CPU_SETSIZE) {
+                return false;
+            }
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+            (void)cpu;
+            return false;
+#endif
         }
 
         /**
          * Stop, join, and destroy all worker threads.
+         *
+         * Tasks left in the workers' deques are moved to the injection queue.
          */
         void stop_all_threads() {
             const std::lock_guard<std::recursive_mutex> threads_lock(thread_mutex);
@@ -412,29 +1396,75 @@ namespace task_thread_pool {
                 }
             }
             threads.clear();
+
+            for (std::size_t i = 0; i < worker_queues.size(); ++i) {
+                worker_queue& queue = worker_queues[i];
+                const std::lock_guard<std::mutex> queue_lock(queue.mutex);
+                for (auto& task : queue.tasks) {
+                    inject(task);
+                }
+                queue.tasks.clear();
+            }
         }
 
         /**
-         * The worker threads.
+         * The worker threads, indexed by worker index. Removed workers stay here until they are joined.
          *
          * Access protected by thread_mutex
          */
         std::vector<std::thread> threads;
 
+        /**
+         * Number of workers. Workers with a higher index have been removed by set_num_threads() and exit once
+         * their own deque is empty.
+         *
+         * Modified with thread_mutex and task_mutex held.
+         */
+        std::atomic<unsigned int> num_workers{0};
+
+        /**
+         * Whether each thread in threads has not yet exited.
+         *
+         * Access protected by task_mutex.
+         */
+        std::vector<bool> worker_running;
+
+        /**
+         * Each worker thread's own task deque, indexed by worker index.
+         *
+         * Grown by start_threads().
+         */
+        worker_queue_table worker_queues;
+
         /**
          * A mutex for methods that start/stop threads.
          */
         mutable std::recursive_mutex thread_mutex;
 
         /**
-         * The task queue.
+         * Number of slots in injection_ring.
+         */
+        static constexpr std::size_t injection_ring_capacity = 512;
+
+        /**
+         * The injection queue. Holds tasks submitted from outside the pool.
+         */
+        mpmc_task_ring injection_ring{injection_ring_capacity};
+
+        /**
+         * Injected tasks that did not fit in injection_ring.
          *
          * Access protected by task_mutex.
          */
-        std::queue<std::packaged_task<void()>> tasks = {};
+        std::queue<inline_task> injection_overflow = {};
+
+        /**
+         * Size of injection_overflow, readable without the lock.
+         */
+        std::atomic<std::size_t> num_overflow_tasks{0};
 
         /**
-         * A mutex for all variables related to tasks.
+         * A mutex for the injection overflow queue and the condition variables.
          */
         mutable std::mutex task_mutex;
 
@@ -449,33 +1479,74 @@ namespace task_thread_pool {
         std::condition_variable task_finished_cv;
 
         /**
-         * A signal for worker threads that the pool is either running or shutting down.
+         * Used by workers to notify that they have tried to pin themselves or have exited.
+         */
+        std::condition_variable workers_cv;
+
+        /**
+         * Number of workers started by start_threads() that have not yet tried to pin themselves.
          *
          * Access protected by task_mutex.
          */
-        bool pool_running = true;
+        unsigned int num_pinning_workers = 0;
+
+        /**
+         * A signal for worker threads that the pool is either running or shutting down.
+         *
+         * Modified with task_mutex held.
+         */
+        std::atomic<bool> pool_running{true};
 
         /**
          * A signal for worker threads to not pull new tasks from the queue.
          *
-         * Access protected by task_mutex.
+         * Modified with task_mutex held.
          */
-        bool pool_paused = false;
+        std::atomic<bool> pool_paused{false};
 
         /**
          * A signal for worker threads that they should notify task_finished_cv when they finish a task.
          *
-         * Access protected by task_mutex.
+         * Modified with task_mutex held.
+         */
+        std::atomic<bool> notify_task_finish{false};
+
+        /**
+         * Number of tasks in the injection queue and all worker deques.
+         * Incremented before a task is added to a queue and decremented after it is removed.
          */
-        bool notify_task_finish = false;
+        std::atomic<std::size_t> num_queued_tasks{0};
 
         /**
          * A counter of the number of tasks in-progress by worker threads.
-         * Incremented when a task is popped off the task queue and decremented when that task is complete.
+         * Incremented when a task is popped off a task queue and decremented when that task is complete.
+         */
+        std::atomic<int> num_inflight_tasks{0};
+
+        /**
+         * How workers wait for tasks.
+         */
+        const idle_strategy idle;
+
+        /**
+         * Which CPUs workers are pinned to.
+         */
+        const cpu_affinity affinity;
+
+        /**
+         * The CPU each worker is pinned to, or -1. See get_worker_cpus().
          *
-         * Access protected by task_mutex.
+         * Access protected by thread_mutex. While start_threads() waits on workers_cv, workers record a failed
+         * pin with task_mutex held.
+         */
+        std::vector<int> worker_cpus;
+
+        /**
+         * Number of worker threads waiting on task_cv.
+         *
+         * Modified with task_mutex held.
          */
-        int num_inflight_tasks = 0;
+        std::atomic<unsigned int> num_idle_workers{0};
     };
 }
 
@@ -0,0 +1,130 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by:
+// the BSD 2-clause license, the MIT license, or at your choosing the BSL-1.0 license found in the LICENSE.*.txt files.
+// SPDX-License-Identifier: BSD-2-Clause OR MIT OR BSL-1.0
+
+#ifndef POOLSTL_INTERNAL_TEMP_BUFFER_HPP
+#define POOLSTL_INTERNAL_TEMP_BUFFER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace poolstl {
+    namespace internal {
+
+        /**
+         * One block of memory per thread that temp_buffer reuses instead of allocating.
+         *
+         * A released block is kept if it is the largest seen so far on this thread and not larger than
+         * max_cached_bytes. Once warmed up, repeated calls on similar sizes do not allocate.
+         */
+        class temp_buffer_cache {
+        public:
+            /**
+             * @return At least `bytes` bytes, aligned for any fundamental type. The cached block if it is large
+             *         enough and not already in use.
+             */
+            static void* acquire(std::size_t bytes) {
+                cached_block& cached = get_cached_block();
+                if (cached.ptr && !cached.in_use && cached.bytes >= bytes) {
+                    cached.in_use = true;
+                    return cached.ptr;
+                }
+                return ::operator new(bytes);
+            }
+
+            /**
+             * Return memory from acquire(), on the thread that acquired it.
+             */
+            static void release(void* ptr, std::size_t bytes) {
+                cached_block& cached = get_cached_block();
+                if (ptr == cached.ptr) {
+                    cached.in_use = false;
+                    return;
+                }
+                if (!cached.in_use && bytes > cached.bytes && bytes <= max_cached_bytes) {
+                    ::operator delete(cached.ptr);
+                    cached.ptr = ptr;
+                    cached.bytes = bytes;
+                    return;
+                }
+                ::operator delete(ptr);
+            }
+
+            /**
+             * Cap on the size of the block kept per thread.
+             */
+            static constexpr std::size_t max_cached_bytes = 16 * 1024 * 1024;
+
+        protected:
+            struct cached_block {
+                cached_block() = default;
+                cached_block(const cached_block&) = delete;
+                cached_block& operator=(const cached_block&) = delete;
+                ~cached_block() {
+                    ::operator delete(ptr);
+                }
+
+                void* ptr = nullptr;
+                std::size_t bytes = 0;
+                bool in_use = false;
+            };
+
+            static cached_block& get_cached_block() {
+                static thread_local cached_block block;
+                return block;
+            }
+        };
+
+        /**
+         * Uninitialized scratch storage for `n` elements of type T.
+         *
+         * Only the memory is owned. Elements are constructed and destroyed by the user, who must destroy every
+         * element it constructed before the buffer is destroyed. The memory comes from temp_buffer_cache, so the
+         * buffer must be destroyed on the thread that created it.
+         */
+        template <class T>
+        class temp_buffer {
+        public:
+            explicit temp_buffer(std::size_t n): buf(n > 0 ? allocate(n) : nullptr), n(n) {}
+            temp_buffer(const temp_buffer&) = delete;
+            temp_buffer& operator=(const temp_buffer&) = delete;
+            ~temp_buffer() {
+                if (buf) {
+                    deallocate(buf, n);
+                }
+            }
+
+            T* data() { return buf; }
+            std::size_t size() const { return n; }
+
+        protected:
+            // Over-aligned types bypass the cache, whose blocks only have fundamental alignment.
+            static constexpr bool use_cache = alignof(T) <= alignof(std::max_align_t);
+
+            static T* allocate(std::size_t n) {
+                if (!use_cache) {
+                    return std::allocator<T>().allocate(n);
+                }
+                if (n > (std::size_t)-1 / sizeof(T)) {
+                    throw std::bad_alloc();
+                }
+                return static_cast<T*>(temp_buffer_cache::acquire(n * sizeof(T)));
+            }
+
+            static void deallocate(T* p, std::size_t n) {
+                if (!use_cache) {
+                    std::allocator<T>().deallocate(p, n);
+                } else {
+                    temp_buffer_cache::release(p, n * sizeof(T));
+                }
+            }
+
+            T* buf;
+            std::size_t n;
+        };
+    }
+}
+
+#endif
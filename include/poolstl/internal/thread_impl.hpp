@@ -37,7 +37,7 @@ namespace poolstl {
         parallel_chunk_for_1_wait(ExecPolicy &&policy, RandIt first, RandIt last,
                                   Chunk chunk, ChunkRet*, int extra_split_factor, A&&... chunk_args) {
             std::vector<std::thread> threads;
-            auto chunk_size = get_chunk_size(first, last, extra_split_factor * policy.get_num_threads());
+            auto chunk_size = get_chunk_size(first, last, std::max(extra_split_factor, 1) * policy.get_num_threads());
 
             while (first < last) {
                 auto iter_chunk_size = get_iter_chunk_size(first, last, chunk_size);
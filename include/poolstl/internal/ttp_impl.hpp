@@ -7,34 +7,233 @@
 #define POOLSTL_INTERNAL_TTP_IMPL_HPP
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
 #include <future>
+#include <iterator>
+#include <memory>
 #include <numeric>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "pooled_future.hpp"
+#include "task_latch.hpp"
+#include "temp_buffer.hpp"
 #include "utils.hpp"
 #include "../execution"
 
+#if POOLSTL_HAVE_CXX17_LIB
+#include <optional>
+#include <thread>
+#include <tuple>
+#endif
+
 namespace poolstl {
     namespace internal {
 
+        /**
+         * Like task_thread_pool::submit(), but returns a pooled_future. Does not allocate if the bound Callable
+         * fits in the pool's inline task buffer.
+         */
+        template <class F, class... A>
+        auto submit_pooled(task_thread_pool::task_thread_pool& task_pool, F&& func, A&&... args)
+            -> pooled_future<decltype(std::bind(std::forward<F>(func), std::forward<A>(args)...)())> {
+            using Bound = decltype(std::bind(std::forward<F>(func), std::forward<A>(args)...));
+            using R = decltype(std::declval<Bound&>()());
+
+            pooled_state<R>* state = pooled_state<R>::acquire(&task_pool);
+            pooled_future<R> ret(state);
+            task_pool.submit_detach(pooled_task<R, Bound>(state, std::bind(std::forward<F>(func),
+                                                                           std::forward<A>(args)...)));
+            return ret;
+        }
+
+        /**
+         * Probe chunks run until they have taken at least this long, so that the measured time is meaningful.
+         */
+        constexpr std::int64_t chunk_probe_ns = 2000;
+
+        /**
+         * Minimum duration of a chunk handed to another thread. Shorter chunks cost more to hand off than they save.
+         */
+        constexpr std::int64_t min_chunk_ns = 20000;
+
+        /**
+         * Chunks of `chunk_size` elements that cover [first, last). The last chunk may be shorter.
+         */
+        struct chunk_plan {
+            std::ptrdiff_t first;
+            std::ptrdiff_t last;
+            std::ptrdiff_t chunk_size;
+
+            std::size_t num_chunks() const {
+                return (std::size_t)((last - first + chunk_size - 1) / chunk_size);
+            }
+            std::ptrdiff_t chunk_begin(std::size_t i) const {
+                return first + (std::ptrdiff_t)i * chunk_size;
+            }
+            std::ptrdiff_t chunk_end(std::size_t i) const {
+                return std::min(chunk_begin(i) + chunk_size, last);
+            }
+        };
+
+        /**
+         * Split [0, num_steps) into chunks.
+         *
+         * Chunks have at least the policy's grain of elements. Without a grain and with `probe` set, the calling
+         * thread first runs probe chunks of 1, 2, 4, ... elements, by calling `run_probe(chunk_begin, chunk_end)`,
+         * until the elapsed time is measurable. The remaining chunks are then sized to take at least min_chunk_ns.
+         *
+         * @param extra_split_factor Split into up to this many chunks per thread.
+         * @param probe Whether to measure the per-element cost. Without a grain and without probing, chunks may be
+         *              as small as one element.
+         * @return The chunks left after probing. Ranges too small for two chunks are left as one chunk.
+         */
+        template <class ExecPolicy, class RunProbe>
+        chunk_plan chunk_adaptive(ExecPolicy& policy, std::ptrdiff_t num_steps, int extra_split_factor, bool probe,
+                                  RunProbe run_probe) {
+            const std::ptrdiff_t max_chunks = (std::ptrdiff_t)policy.pool()->get_num_threads() *
+                                              std::max(extra_split_factor, 1);
+            std::ptrdiff_t grain = (std::ptrdiff_t)policy.grain();
+            std::ptrdiff_t done = 0;
+
+            if (grain == 0 && probe && max_chunks > 1) {
+                using clock = std::chrono::steady_clock;
+                const auto start = clock::now();
+                std::int64_t elapsed_ns = 0;
+                for (std::ptrdiff_t probe_size = 1; done < num_steps; probe_size *= 2) {
+                    std::ptrdiff_t probe_end = done + std::min(probe_size, num_steps - done);
+                    run_probe(done, probe_end);
+                    done = probe_end;
+
+                    elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+                    if (elapsed_ns >= chunk_probe_ns) {
+                        break;
+                    }
+                }
+                if (done == num_steps) {
+                    return chunk_plan{done, done, 1};
+                }
+                grain = (std::ptrdiff_t)(min_chunk_ns * (std::int64_t)done / elapsed_ns);
+            }
+
+            grain = std::max(grain, (std::ptrdiff_t)1);
+            const std::ptrdiff_t remaining = num_steps - done;
+            const std::ptrdiff_t num_chunks = std::max(std::min(max_chunks, remaining / grain), (std::ptrdiff_t)1);
+            const std::ptrdiff_t chunk_size = std::max((remaining + num_chunks - 1) / num_chunks, (std::ptrdiff_t)1);
+            return chunk_plan{done, num_steps, chunk_size};
+        }
+
+        /**
+         * Upper bound on the number of chunks that chunk_adaptive() creates.
+         */
+        template <class ExecPolicy>
+        std::size_t max_adaptive_chunks(ExecPolicy& policy, std::ptrdiff_t num_steps, int extra_split_factor,
+                                        bool probe) {
+            std::size_t ret = (std::size_t)policy.pool()->get_num_threads() * std::max(extra_split_factor, 1);
+            if (policy.grain() == 0 && probe) {
+                // probe sizes double, so there are at most log2(num_steps) + 1 probes
+                for (std::ptrdiff_t n = num_steps; n > 0; n /= 2) {
+                    ++ret;
+                }
+            }
+            return ret;
+        }
+
+        /**
+         * Add a chunk to `job`. Runs it on the calling thread if `on_caller` is set, else submits it to the pool.
+         */
+        template <class ChunkRet, class F>
+        void spawn_chunk(task_thread_pool::task_thread_pool& task_pool, chunk_job<ChunkRet>& job, bool on_caller,
+                         F&& func) {
+            job.latch.add();
+            chunk_task<ChunkRet, typename std::decay<F>::type> task(&job, job.results.next_index(),
+                                                                    std::forward<F>(func));
+            if (on_caller) {
+                task_pool.run_inline(task);
+            } else {
+                task_pool.submit_detach(std::move(task));
+            }
+        }
+
+        /**
+         * Add `n` chunks to `job` and submit them to the pool in one batch. Chunk i is the Callable returned by
+         * `make_chunk(i)`, which is called by the thread that runs the chunk.
+         */
+        template <class ChunkRet, class MakeChunk>
+        void spawn_chunks(task_thread_pool::task_thread_pool& task_pool, chunk_job<ChunkRet>& job, std::size_t n,
+                          MakeChunk make_chunk) {
+            if (n == 0) {
+                return;
+            }
+            job.latch.add((std::ptrdiff_t)n);
+            const std::size_t first_index = job.results.next_index();
+            for (std::size_t i = 1; i < n; ++i) {
+                job.results.next_index();
+            }
+            task_pool.submit_bulk(n, chunk_batch<ChunkRet, MakeChunk>(&job, first_index, n, std::move(make_chunk)));
+        }
+
+        /**
+         * Run the chunks planned by chunk_adaptive() and wait for them to finish. The last chunk runs on the
+         * calling thread and the others are submitted to the pool in one batch.
+         *
+         * @param make_chunk Called as `make_chunk(chunk_begin, chunk_end)`. Returns a zero-argument Callable
+         *                   that processes that chunk.
+         * @return The chunks' results, in order.
+         */
+        template <class ChunkRet, class ExecPolicy, class MakeChunk>
+        chunk_results<ChunkRet> run_chunks(ExecPolicy& policy, std::ptrdiff_t num_steps, int extra_split_factor,
+                                           bool probe, MakeChunk make_chunk) {
+            auto& task_pool = *policy.pool();
+            chunk_job<ChunkRet> job(&task_pool, max_adaptive_chunks(policy, num_steps, extra_split_factor, probe));
+
+            try {
+                const chunk_plan plan = chunk_adaptive(policy, num_steps, extra_split_factor, probe,
+                                                       [&](std::ptrdiff_t chunk_begin, std::ptrdiff_t chunk_end) {
+                    spawn_chunk(task_pool, job, true, make_chunk(chunk_begin, chunk_end));
+                });
+                const std::size_t num_chunks = plan.num_chunks();
+                if (num_chunks > 0) {
+                    spawn_chunks(task_pool, job, num_chunks - 1, [&make_chunk, plan](std::size_t i) {
+                        return make_chunk(plan.chunk_begin(i), plan.chunk_end(i));
+                    });
+                    spawn_chunk(task_pool, job, true, make_chunk(plan.chunk_begin(num_chunks - 1), plan.last));
+                }
+            } catch (...) {
+                // Chunks already submitted reference the job, so wait for them before leaving.
+                job.latch.set_exception(std::current_exception());
+            }
+
+            job.latch.wait();
+            return std::move(job.results);
+        }
+
 #if POOLSTL_HAVE_CXX17_LIB
         /**
          * Call std::apply in parallel.
          */
         template <class ExecPolicy, class Op, class ArgContainer>
-        std::vector<std::future<void>>
-        parallel_apply(ExecPolicy &&policy, Op op, const ArgContainer& args_list) {
-            std::vector<std::future<void>> futures;
+        void parallel_apply(ExecPolicy &&policy, Op op, const ArgContainer& args_list) {
             auto& task_pool = *policy.pool();
+            chunk_job<void> job(&task_pool, args_list.size());
 
-            for (const auto& args : args_list) {
-                futures.emplace_back(task_pool.submit([](Op op, const auto& args_fwd) {
-                        std::apply(op, args_fwd);
-                    }, op, args));
+            try {
+                for (std::size_t i = 0; i < args_list.size(); ++i) {
+                    spawn_chunk(task_pool, job, i + 1 == args_list.size(),
+                                std::bind([](Op op, const auto& args_fwd) {
+                                    std::apply(op, args_fwd);
+                                }, op, args_list[i]));
+                }
+            } catch (...) {
+                job.latch.set_exception(std::current_exception());
             }
 
-            return futures;
+            job.latch.wait();
         }
 #endif
 
@@ -43,48 +242,29 @@ namespace poolstl {
          */
         template <class ExecPolicy, class RandIt, class Chunk,
             class ChunkRet = decltype(std::declval<Chunk>()(std::declval<RandIt>(), std::declval<RandIt>()))>
-        std::vector<std::future<ChunkRet>>
+        chunk_results<ChunkRet>
         parallel_chunk_for_gen(ExecPolicy &&policy, RandIt first, RandIt last, Chunk chunk,
                                ChunkRet* = (decltype(std::declval<Chunk>()(std::declval<RandIt>(),
                                                      std::declval<RandIt>()))*)nullptr,
                                int extra_split_factor = 1) {
-            std::vector<std::future<ChunkRet>> futures;
-            auto& task_pool = *policy.pool();
-            auto chunk_size = get_chunk_size(first, last, extra_split_factor * task_pool.get_num_threads());
-
-            while (first < last) {
-                auto iter_chunk_size = get_iter_chunk_size(first, last, chunk_size);
-                RandIt loop_end = advanced(first, iter_chunk_size);
-
-                futures.emplace_back(task_pool.submit(chunk, first, loop_end));
-
-                first = loop_end;
-            }
-
-            return futures;
+            return run_chunks<ChunkRet>(policy, std::distance(first, last), extra_split_factor, false,
+                                        [&](std::ptrdiff_t chunk_begin, std::ptrdiff_t chunk_end) {
+                return std::bind(chunk, advanced(first, chunk_begin), advanced(first, chunk_end));
+            });
         }
 
         /**
          * Chunk a single range.
          */
         template <class ExecPolicy, class RandIt, class Chunk, class ChunkRet, typename... A>
-        std::vector<std::future<ChunkRet>>
+        chunk_results<ChunkRet>
         parallel_chunk_for_1(ExecPolicy &&policy, RandIt first, RandIt last,
                              Chunk chunk, ChunkRet*, int extra_split_factor, A&&... chunk_args) {
-            std::vector<std::future<ChunkRet>> futures;
-            auto& task_pool = *policy.pool();
-            auto chunk_size = get_chunk_size(first, last, extra_split_factor * task_pool.get_num_threads());
-
-            while (first < last) {
-                auto iter_chunk_size = get_iter_chunk_size(first, last, chunk_size);
-                RandIt loop_end = advanced(first, iter_chunk_size);
-
-                futures.emplace_back(task_pool.submit(chunk, first, loop_end, chunk_args...));
-
-                first = loop_end;
-            }
-
-            return futures;
+            return run_chunks<ChunkRet>(policy, std::distance(first, last), extra_split_factor,
+                                        extra_split_factor != one_chunk_per_thread,
+                                        [&](std::ptrdiff_t chunk_begin, std::ptrdiff_t chunk_end) {
+                return std::bind(chunk, advanced(first, chunk_begin), advanced(first, chunk_end), chunk_args...);
+            });
         }
 
         /**
@@ -94,33 +274,22 @@ namespace poolstl {
         typename std::enable_if<!is_pure_threads_policy<ExecPolicy>::value, void>::type
         parallel_chunk_for_1_wait(ExecPolicy &&policy, RandIt first, RandIt last,
                                   Chunk chunk, ChunkRet* rettype, int extra_split_factor, A&&... chunk_args) {
-            auto futures = parallel_chunk_for_1(std::forward<ExecPolicy>(policy), first, last,
-                                                chunk, rettype, extra_split_factor, chunk_args...);
-            get_futures(futures);
+            parallel_chunk_for_1(std::forward<ExecPolicy>(policy), first, last,
+                                 chunk, rettype, extra_split_factor, chunk_args...);
         }
 
         /**
          * Element-wise chunk two ranges.
          */
         template <class ExecPolicy, class RandIt1, class RandIt2, class Chunk, class ChunkRet, typename... A>
-        std::vector<std::future<ChunkRet>>
+        chunk_results<ChunkRet>
         parallel_chunk_for_2(ExecPolicy &&policy, RandIt1 first1, RandIt1 last1, RandIt2 first2,
                              Chunk chunk, ChunkRet*, A&&... chunk_args) {
-            std::vector<std::future<ChunkRet>> futures;
-            auto& task_pool = *policy.pool();
-            auto chunk_size = get_chunk_size(first1, last1, task_pool.get_num_threads());
-
-            while (first1 < last1) {
-                auto iter_chunk_size = get_iter_chunk_size(first1, last1, chunk_size);
-                RandIt1 loop_end = advanced(first1, iter_chunk_size);
-
-                futures.emplace_back(task_pool.submit(chunk, first1, loop_end, first2, chunk_args...));
-
-                first1 = loop_end;
-                std::advance(first2, iter_chunk_size);
-            }
-
-            return futures;
+            return run_chunks<ChunkRet>(policy, std::distance(first1, last1), 1, true,
+                                        [&](std::ptrdiff_t chunk_begin, std::ptrdiff_t chunk_end) {
+                return std::bind(chunk, advanced(first1, chunk_begin), advanced(first1, chunk_end),
+                                 advanced(first2, chunk_begin), chunk_args...);
+            });
         }
 
         /**
@@ -128,215 +297,2291 @@ namespace poolstl {
          */
         template <class ExecPolicy, class RandIt1, class RandIt2, class RandIt3,
                   class Chunk, class ChunkRet, typename... A>
-        std::vector<std::future<ChunkRet>>
+        chunk_results<ChunkRet>
         parallel_chunk_for_3(ExecPolicy &&policy, RandIt1 first1, RandIt1 last1, RandIt2 first2, RandIt3 first3,
                            Chunk chunk, ChunkRet*, A&&... chunk_args) {
-            std::vector<std::future<ChunkRet>> futures;
-            auto& task_pool = *policy.pool();
-            auto chunk_size = get_chunk_size(first1, last1, task_pool.get_num_threads());
+            return run_chunks<ChunkRet>(policy, std::distance(first1, last1), 1, true,
+                                        [&](std::ptrdiff_t chunk_begin, std::ptrdiff_t chunk_end) {
+                return std::bind(chunk, advanced(first1, chunk_begin), advanced(first1, chunk_end),
+                                 advanced(first2, chunk_begin), advanced(first3, chunk_begin), chunk_args...);
+            });
+        }
+
+#if POOLSTL_HAVE_CXX17_LIB
+        /**
+         * Input bytes per tile of a single-pass scan. Small enough that a tile is still in cache when it is
+         * re-read to write the output.
+         */
+        constexpr std::size_t scan_tile_bytes = 16 * 1024;
+
+        /**
+         * The single-pass scan is used when there are at least this many tiles per thread.
+         */
+        constexpr std::size_t scan_lookback_min_tiles_per_thread = 4;
+
+        /**
+         * What a tile of a single-pass scan has published for its successors.
+         */
+        template <class T>
+        struct alignas(64) scan_tile_status {
+            enum : int { empty = 0, has_aggregate = 1, has_prefix = 2, failed = 3 };
+
+            std::atomic<int> flag{empty};
+            // Sum of this tile only. Valid once flag is has_aggregate.
+            std::optional<T> aggregate;
+            // Sum of init and every element up to and including this tile. Valid once flag is has_prefix.
+            std::optional<T> prefix;
+        };
 
-            while (first1 < last1) {
-                auto iter_chunk_size = get_iter_chunk_size(first1, last1, chunk_size);
-                RandIt1 loop_end = advanced(first1, iter_chunk_size);
+        /**
+         * Marks, for the calling thread, a single-pass scan that it is working on a tile of.
+         */
+        class scan_worker_frame {
+        public:
+            explicit scan_worker_frame(const void* scan): scan(scan), prev(top()) { top() = this; }
+            ~scan_worker_frame() { top() = prev; }
+            scan_worker_frame(const scan_worker_frame&) = delete;
+            scan_worker_frame& operator=(const scan_worker_frame&) = delete;
 
-                futures.emplace_back(task_pool.submit(chunk, first1, loop_end, first2, first3, chunk_args...));
+            /**
+             * Whether the calling thread is already working on a tile of `scan`, further down its stack.
+             */
+            static bool is_active(const void* scan) {
+                for (const scan_worker_frame* frame = top(); frame; frame = frame->prev) {
+                    if (frame->scan == scan) {
+                        return true;
+                    }
+                }
+                return false;
+            }
 
-                first1 = loop_end;
-                std::advance(first2, iter_chunk_size);
-                std::advance(first3, iter_chunk_size);
+        protected:
+            static const scan_worker_frame*& top() {
+                static thread_local const scan_worker_frame* frame = nullptr;
+                return frame;
             }
 
-            return futures;
-        }
+            const void* scan;
+            const scan_worker_frame* prev;
+        };
 
         /**
-         * Sort a range in parallel.
+         * Single-pass parallel scan using decoupled look-back. See parallel_scan() for parameters.
          *
-         * @param sort_func Sequential sort method, like std::sort or std::stable_sort
-         * @param merge_func Sequential merge method, like std::inplace_merge
+         * The input is split into cache-sized tiles, claimed in order by one worker per thread. A worker reduces
+         * its tile and publishes the tile's aggregate. It then walks back over its predecessors, summing their
+         * aggregates until one has published an inclusive prefix, and publishes its own inclusive prefix.
+         * Finally it scans the tile, which is still in cache, into dest. The input is read from memory once
+         * instead of twice.
+         *
+         * Tiles are claimed in order, so a tile only waits on earlier tiles that are already being worked on.
+         * A worker that starts on a thread that is already working on a tile of the same scan, for example while
+         * helping the pool from inside binop, claims nothing; its tiles would wait on the one below it.
          */
-        template <class ExecPolicy, class RandIt, class Compare, class SortFunc, class MergeFunc>
-        void parallel_mergesort(ExecPolicy &&policy, RandIt first, RandIt last,
-                                Compare comp, SortFunc sort_func, MergeFunc merge_func) {
-            if (first == last) {
-                return;
-            }
+        template <class ExecPolicy, class RandIt1, class RandIt2, class T, class BinaryOp, class UnaryOp>
+        RandIt2 parallel_scan_lookback(ExecPolicy &&policy, RandIt1 first, RandIt1 last, RandIt2 dest,
+                                       std::optional<T> init, BinaryOp binop, UnaryOp unary_op, bool inclusive,
+                                       std::ptrdiff_t tile_size) {
+            using status_type = scan_tile_status<T>;
+            const std::ptrdiff_t num_steps = last - first;
+            const std::size_t num_tiles = (std::size_t)((num_steps + tile_size - 1) / tile_size);
+            std::vector<status_type> tiles(num_tiles);
+            std::atomic<std::size_t> next_tile{0};
 
-            // Sort chunks in parallel
-            auto futures = parallel_chunk_for_gen(std::forward<ExecPolicy>(policy), first, last,
-                             [&comp, sort_func] (RandIt chunk_first, RandIt chunk_last) {
-                                 sort_func(chunk_first, chunk_last, comp);
-                                 return std::make_pair(chunk_first, chunk_last);
-                             });
+            // Returns false if a predecessor failed.
+            auto process_tile = [&](std::size_t tile) {
+                RandIt1 tile_first = first + (std::ptrdiff_t)tile * tile_size;
+                RandIt1 tile_last = first + std::min((std::ptrdiff_t)(tile + 1) * tile_size, num_steps);
+                auto& status = tiles[tile];
 
-            // Merge the sorted ranges
-            using SortedRange = std::pair<RandIt, RandIt>;
-            auto& task_pool = *policy.pool();
-            std::vector<SortedRange> subranges;
-            do {
-                for (auto& future : futures) {
-                    subranges.emplace_back(future.get());
-                }
-                futures.clear();
-
-                for (std::size_t i = 0; i < subranges.size(); ++i) {
-                    if (i + 1 < subranges.size()) {
-                        // pair up and merge
-                        auto& lhs = subranges[i];
-                        auto& rhs = subranges[i + 1];
-                        futures.emplace_back(task_pool.submit([&comp, merge_func] (RandIt chunk_first,
-                                                                                   RandIt chunk_middle,
-                                                                                   RandIt chunk_last) {
-                            merge_func(chunk_first, chunk_middle, chunk_last, comp);
-                            return std::make_pair(chunk_first, chunk_last);
-                        }, lhs.first, lhs.second, rhs.second));
-                        ++i;
+                T aggregate = unary_op(*tile_first);
+                for (RandIt1 it = tile_first + 1; it != tile_last; ++it) {
+                    aggregate = binop(std::move(aggregate), unary_op(*it));
+                }
+
+                RandIt2 tile_dest = dest + (tile_first - first);
+                if (tile == 0) {
+                    // Nothing to look back on. The prefix starts from init.
+                    if (init) {
+                        status.prefix = binop(*init, aggregate);
                     } else {
-                        // forward the final extra range
-                        std::promise<SortedRange> p;
-                        futures.emplace_back(p.get_future());
-                        p.set_value(subranges[i]);
+                        status.prefix = std::move(aggregate);
                     }
-                }
+                    status.flag.store(status_type::has_prefix, std::memory_order_release);
 
-                subranges.clear();
-            } while (futures.size() > 1);
-            futures.front().get();
-        }
+                    if (!inclusive) {
+                        std::transform_exclusive_scan(tile_first, tile_last, tile_dest, *init, binop, unary_op);
+                    } else if (init) {
+                        std::transform_inclusive_scan(tile_first, tile_last, tile_dest, binop, unary_op, *init);
+                    } else {
+                        std::transform_inclusive_scan(tile_first, tile_last, tile_dest, binop, unary_op);
+                    }
+                    return true;
+                }
 
-        /**
-         * Quicksort worker function.
-         */
-        template <class RandIt, class Compare, class SortFunc, class PartFunc, class PivotFunc>
-        void quicksort_impl(task_thread_pool::task_thread_pool* task_pool, const RandIt first, const RandIt last,
-                            Compare comp, SortFunc sort_func, PartFunc part_func, PivotFunc pivot_func,
-                            std::ptrdiff_t target_leaf_size,
-                            std::vector<std::future<void>>* futures, std::mutex* mutex,
-                            std::condition_variable* cv, int* inflight_spawns) {
-            using T = typename std::iterator_traits<RandIt>::value_type;
+                status.aggregate = aggregate;
+                status.flag.store(status_type::has_aggregate, std::memory_order_release);
 
-            auto partition_size = std::distance(first, last);
+                // Returns the predecessor's flag once it has published something.
+                auto wait_for = [&](std::size_t pred) {
+                    int flag;
+                    while ((flag = tiles[pred].flag.load(std::memory_order_acquire)) == status_type::empty) {
+                        std::this_thread::yield();
+                    }
+                    return flag;
+                };
+                auto published_sum = [&](std::size_t pred, int flag) -> const T& {
+                    return flag == status_type::has_prefix ? *tiles[pred].prefix : *tiles[pred].aggregate;
+                };
 
-            if (partition_size > target_leaf_size) {
-                // partition the range
-                auto mid = part_func(first, last, pivot_predicate<Compare, T>(comp, pivot_func(first, last)));
+                // Find the sum of everything before this tile. Sum predecessors' aggregates until one has
+                // published its prefix, which already includes init.
+                std::size_t pred = tile - 1;
+                int flag = wait_for(pred);
+                if (flag == status_type::failed) {
+                    return false;
+                }
+                T exclusive = published_sum(pred, flag);
+                while (flag != status_type::has_prefix) {
+                    flag = wait_for(--pred);
+                    if (flag == status_type::failed) {
+                        return false;
+                    }
+                    exclusive = binop(published_sum(pred, flag), std::move(exclusive));
+                }
 
-                if (mid != first && mid != last) {
-                    // was able to partition the range, so recurse
-                    std::lock_guard<std::mutex> guard(*mutex);
-                    ++(*inflight_spawns);
+                status.prefix = binop(exclusive, aggregate);
+                status.flag.store(status_type::has_prefix, std::memory_order_release);
 
-                    futures->emplace_back(task_pool->submit(
-                        quicksort_impl<RandIt, Compare, SortFunc, PartFunc, PivotFunc>,
-                        task_pool, first, mid, comp, sort_func, part_func, pivot_func, target_leaf_size,
-                        futures, mutex, cv, inflight_spawns));
+                // Scan the tile, starting from the sum of everything before it.
+                if (inclusive) {
+                    std::transform_inclusive_scan(tile_first, tile_last, tile_dest, binop, unary_op, exclusive);
+                } else {
+                    std::transform_exclusive_scan(tile_first, tile_last, tile_dest, exclusive, binop, unary_op);
+                }
+                return true;
+            };
 
-                    futures->emplace_back(task_pool->submit(
-                        quicksort_impl<RandIt, Compare, SortFunc, PartFunc, PivotFunc>,
-                        task_pool, mid, last, comp, sort_func, part_func, pivot_func, target_leaf_size,
-                        futures, mutex, cv, inflight_spawns));
+            auto worker = [&]() {
+                if (scan_worker_frame::is_active(&tiles)) {
                     return;
                 }
-            }
+                scan_worker_frame frame(&tiles);
 
-            // Range does not need to be subdivided (or was unable to subdivide). Run the sequential sort.
-            {
-                // notify main thread that partitioning may be finished
-                std::lock_guard<std::mutex> guard(*mutex);
-                --(*inflight_spawns);
+                std::size_t tile;
+                while ((tile = next_tile.fetch_add(1, std::memory_order_relaxed)) < num_tiles) {
+                    std::exception_ptr exception;
+                    bool ok = false;
+                    try {
+                        ok = process_tile(tile);
+                    } catch (...) {
+                        exception = std::current_exception();
+                    }
+                    if (!ok) {
+                        // Fail this tile and every unclaimed one, so that no successor waits forever.
+                        // If a predecessor failed, its worker already reported the exception.
+                        tiles[tile].flag.store(status_type::failed, std::memory_order_release);
+                        while ((tile = next_tile.fetch_add(1, std::memory_order_relaxed)) < num_tiles) {
+                            tiles[tile].flag.store(status_type::failed, std::memory_order_release);
+                        }
+                        if (exception) {
+                            std::rethrow_exception(exception);
+                        }
+                        return;
+                    }
+                }
+            };
+
+            auto& task_pool = *policy.pool();
+            const std::size_t num_workers = std::min((std::size_t)task_pool.get_num_threads(), num_tiles);
+            chunk_job<void> job(&task_pool, num_workers);
+            try {
+                spawn_chunks(task_pool, job, num_workers - 1, [&worker](std::size_t) { return std::ref(worker); });
+                spawn_chunk(task_pool, job, true, std::ref(worker));
+            } catch (...) {
+                job.latch.set_exception(std::current_exception());
             }
-            cv->notify_one();
 
-            sort_func(first, last, comp);
+            job.latch.wait();
+            return dest + num_steps;
         }
 
         /**
-         * Sort a range in parallel using quicksort.
+         * Parallel scan of unary_op(*it) over [first, last), written to dest.
          *
-         * @param sort_func Sequential sort method, like std::sort or std::stable_sort
-         * @param part_func Method that partitions a range, like std::partition or std::stable_partition
-         * @param pivot_func Method that identifies the pivot
+         * Large inputs of trivially copyable elements use the single-pass parallel_scan_lookback(). Otherwise:
+         * Pass 1 reduces each chunk. The chunk sums are then scanned sequentially into each chunk's carry-in,
+         * and pass 2 scans each chunk in parallel starting from its carry-in. Chunk sums are folded starting from
+         * each chunk's first element, so binop does not need an identity value.
+         *
+         * @param init Initial value. May be empty for an inclusive scan.
+         * @param inclusive Whether dest[i] includes element i.
          */
-        template <class ExecPolicy, class RandIt, class Compare, class SortFunc, class PartFunc, class PivotFunc>
-        void parallel_quicksort(ExecPolicy &&policy, RandIt first, RandIt last,
-                                Compare comp, SortFunc sort_func, PartFunc part_func, PivotFunc pivot_func) {
+        template <class ExecPolicy, class RandIt1, class RandIt2, class T, class BinaryOp, class UnaryOp>
+        RandIt2 parallel_scan(ExecPolicy &&policy, RandIt1 first, RandIt1 last, RandIt2 dest,
+                              std::optional<T> init, BinaryOp binop, UnaryOp unary_op, bool inclusive) {
             if (first == last) {
-                return;
+                return dest;
             }
 
-            auto& task_pool = *policy.pool();
+            using value_type = typename std::iterator_traits<RandIt1>::value_type;
+            if (std::is_trivially_copyable<T>::value && std::is_trivially_copyable<value_type>::value) {
+                const std::ptrdiff_t tile_size = policy.grain() > 0 ? (std::ptrdiff_t)policy.grain() :
+                    (std::ptrdiff_t)std::max(scan_tile_bytes / sizeof(value_type), (std::size_t)1);
+                const std::size_t num_tiles = (std::size_t)(((last - first) + tile_size - 1) / tile_size);
+                if (num_tiles >= scan_lookback_min_tiles_per_thread * policy.pool()->get_num_threads()) {
+                    return parallel_scan_lookback(std::forward<ExecPolicy>(policy), first, last, dest,
+                                                  std::move(init), binop, unary_op, inclusive, tile_size);
+                }
+            }
 
-            // Target partition size. Range will be recursively partitioned into partitions no bigger than this
-            // size. Target approximately twice as many partitions as threads to reduce impact of uneven pivot
-            // selection.
-            auto num_threads = task_pool.get_num_threads();
-            std::ptrdiff_t target_leaf_size = std::max((std::ptrdiff_t)(std::distance(first, last) / (num_threads * 2)),
-                                                       (std::ptrdiff_t)5);
+            // Pass 1: Chunk the input and find the sum of each chunk
+            auto results = parallel_chunk_for_gen(policy, first, last,
+                               [binop, unary_op](RandIt1 chunk_first, RandIt1 chunk_last) {
+                                   T sum = unary_op(*chunk_first);
+                                   for (RandIt1 it = chunk_first + 1; it != chunk_last; ++it) {
+                                       sum = binop(std::move(sum), unary_op(*it));
+                                   }
+                                   return std::make_tuple(chunk_first, chunk_last, std::move(sum));
+                               });
 
-            if (num_threads == 1) {
-                target_leaf_size = std::distance(first, last);
+            // find the carry-in of each chunk
+            std::vector<std::tuple<RandIt1, RandIt1, RandIt2, std::optional<T>>> args;
+            args.reserve(results.size());
+            std::optional<T> carry = std::move(init);
+            for (auto& res : results) {
+                auto chunk_first = std::get<0>(res);
+                args.emplace_back(chunk_first, std::get<1>(res), dest + (chunk_first - first), carry);
+                auto& chunk_sum = std::get<2>(res);
+                if (carry) {
+                    carry = binop(*carry, chunk_sum);
+                } else {
+                    carry = std::move(chunk_sum);
+                }
             }
 
-            // task_thread_pool does not support creating task DAGs, so organize the code such that
-            // all parallel tasks are independent. The parallel tasks can spawn additional parallel tasks, and they
-            // record their "child" task's std::future into a common vector to be waited on by the main thread.
-            std::mutex mutex;
+            // Pass 2: scan each chunk, starting from the sum of previous chunks
+            parallel_apply(std::forward<ExecPolicy>(policy),
+                [binop, unary_op, inclusive](RandIt1 chunk_first, RandIt1 chunk_last, RandIt2 chunk_dest,
+                                             const std::optional<T>& chunk_init) {
+                    if (!inclusive) {
+                        std::transform_exclusive_scan(chunk_first, chunk_last, chunk_dest, *chunk_init,
+                                                      binop, unary_op);
+                    } else if (chunk_init) {
+                        std::transform_inclusive_scan(chunk_first, chunk_last, chunk_dest, binop, unary_op,
+                                                      *chunk_init);
+                    } else {
+                        std::transform_inclusive_scan(chunk_first, chunk_last, chunk_dest, binop, unary_op);
+                    }
+                }, args);
+            return dest + (last - first);
+        }
+#endif
 
-            // Futures of parallel tasks. Access protected by mutex.
-            std::vector<std::future<void>> futures;
+        /**
+         * Call `func(i)` for each i in [0, n) in parallel, the last on the calling thread, and wait for all calls.
+         *
+         * Every call is made exactly once, even if a task cannot be submitted or is dropped by the pool; such
+         * calls run on the calling thread instead. For work that must complete to leave data in a valid state.
+         * Once all calls are done, the first exception thrown by `func` is rethrown.
+         */
+        template <class F>
+        void parallel_for_each_index(task_thread_pool::task_thread_pool& task_pool, std::size_t n, F func) {
+            std::vector<char> called(n, 0);
+            std::atomic<bool> has_error{false};
+            std::exception_ptr error;
+            auto call = [&](std::size_t i) {
+                called[i] = 1;
+                try {
+                    func(i);
+                } catch (...) {
+                    if (!has_error.exchange(true)) {
+                        error = std::current_exception();
+                    }
+                }
+            };
 
-            // For signaling that all partitioning has been completed and futures vector is complete. Uses mutex.
-            std::condition_variable cv;
+            {
+                chunk_job<void> job(&task_pool, n);
+                try {
+                    if (n > 0) {
+                        spawn_chunks(task_pool, job, n - 1, [&call](std::size_t i) {
+                            return [&call, i]() { call(i); };
+                        });
+                        spawn_chunk(task_pool, job, true, [&call, n]() { call(n - 1); });
+                    }
+                } catch (...) {
+                    job.latch.set_exception(std::current_exception());
+                }
+                try {
+                    job.latch.wait();
+                } catch (...) {
+                    // Only failures to run a task end up here. Those calls are made below.
+                }
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                if (!called[i]) {
+                    call(i);
+                }
+            }
 
-            // Number of `quicksort_impl` calls that haven't finished yet. Nonzero value means futures vector may
-            // still be modified. Access protected by mutex.
-            int inflight_spawns = 1;
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
 
-            // Root task.
-            quicksort_impl(&task_pool, first, last, comp, sort_func, part_func, pivot_func, target_leaf_size,
-                           &futures, &mutex, &cv, &inflight_spawns);
+        /**
+         * Merges and rotations smaller than this are not split between threads.
+         */
+        constexpr std::ptrdiff_t merge_split_min_size = 8192;
 
-            // Wait for all partitioning to finish.
-            {
-                std::unique_lock<std::mutex> lock(mutex);
-                cv.wait(lock, [&] { return inflight_spawns == 0; });
+        /**
+         * Reverse a range, split into up to `num_parts` parallel tasks.
+         */
+        template <class RandIt>
+        void parallel_reverse(task_thread_pool::task_thread_pool& task_pool, RandIt first, RandIt last,
+                              std::size_t num_parts) {
+            const std::ptrdiff_t num_swaps = (last - first) / 2;
+            if (num_parts < 2 || num_swaps < merge_split_min_size) {
+                std::reverse(first, last);
+                return;
             }
 
-            // Wait on all the parallel tasks.
-            get_futures(futures);
+            const std::ptrdiff_t part_size = (num_swaps + (std::ptrdiff_t)num_parts - 1) / (std::ptrdiff_t)num_parts;
+            parallel_for_each_index(task_pool, (std::size_t)((num_swaps + part_size - 1) / part_size),
+                                    [&](std::size_t part) {
+                const std::ptrdiff_t part_begin = (std::ptrdiff_t)part * part_size;
+                const std::ptrdiff_t part_end = std::min(part_begin + part_size, num_swaps);
+                std::swap_ranges(first + part_begin, first + part_end,
+                                 std::reverse_iterator<RandIt>(last - part_begin));
+            });
+        }
+
+        /**
+         * Like std::rotate, but in parallel. Implemented as three reversals.
+         */
+        template <class RandIt>
+        void parallel_rotate(task_thread_pool::task_thread_pool& task_pool, RandIt first, RandIt middle, RandIt last,
+                             std::size_t num_parts) {
+            if (first == middle || middle == last) {
+                return;
+            }
+            if (num_parts < 2 || last - first < 2 * merge_split_min_size) {
+                std::rotate(first, middle, last);
+                return;
+            }
+
+            parallel_reverse(task_pool, first, middle, num_parts);
+            parallel_reverse(task_pool, middle, last, num_parts);
+            parallel_reverse(task_pool, first, last, num_parts);
+        }
+
+        /**
+         * Find how many of the first `rank` elements of a stable merge of A and B come from A.
+         * On ties, elements of A come first.
+         */
+        template <class RandIt1, class RandIt2, class Compare>
+        std::ptrdiff_t merge_path_corank(std::ptrdiff_t rank, RandIt1 a, std::ptrdiff_t a_size,
+                                         RandIt2 b, std::ptrdiff_t b_size, Compare& comp) {
+            std::ptrdiff_t lo = std::max(rank - b_size, (std::ptrdiff_t)0);
+            std::ptrdiff_t hi = std::min(rank, a_size);
+            // Find the largest i such that A[i-1] does not belong after B[rank-i].
+            while (lo < hi) {
+                const std::ptrdiff_t mid = lo + (hi - lo + 1) / 2;
+                if (comp(b[rank - mid], a[mid - 1])) {
+                    hi = mid - 1;
+                } else {
+                    lo = mid;
+                }
+            }
+            return lo;
         }
 
         /**
-         * Partition range according to predicate. Unstable.
+         * Like std::merge, but moves elements instead of copying them.
          *
-         * This implementation only parallelizes with p=2; will spawn and wait for only one task.
+         * If comp throws, the elements not yet merged are still moved to dest, unmerged, before the exception is
+         * rethrown. dest then holds every element of both inputs.
          */
-        template <class RandIt, class Predicate>
-        RandIt partition_p2(task_thread_pool::task_thread_pool &task_pool, RandIt first, RandIt last, Predicate pred) {
-            auto range_size = std::distance(first, last);
-            if (range_size < 4) {
-                return std::partition(first, last, pred);
+        template <class InIt1, class InIt2, class OutIt, class Compare>
+        OutIt move_merge(InIt1 first1, InIt1 last1, InIt2 first2, InIt2 last2, OutIt dest, Compare& comp) {
+            try {
+                for (; first1 != last1 && first2 != last2; ++dest) {
+                    if (comp(*first2, *first1)) {
+                        *dest = std::move(*first2);
+                        ++first2;
+                    } else {
+                        *dest = std::move(*first1);
+                        ++first1;
+                    }
+                }
+            } catch (...) {
+                dest = std::move(first1, last1, dest);
+                std::move(first2, last2, dest);
+                throw;
             }
+            dest = std::move(first1, last1, dest);
+            return std::move(first2, last2, dest);
+        }
 
-            // approach should be generalizable to arbitrary p
+        /**
+         * Merge sorted [first1, last1) and [first2, last2) into dest, in parallel.
+         *
+         * The output is split into chunks. Each chunk co-ranks its own bounds to find its slices of the two
+         * inputs, so the chunks merge independently of each other.
+         *
+         * @param merge_func Sequential merge method, like std::merge
+         */
+        template <class ExecPolicy, class RandIt1, class RandIt2, class RandIt3, class Compare, class MergeFunc>
+        RandIt3 parallel_merge(ExecPolicy &&policy, RandIt1 first1, RandIt1 last1, RandIt2 first2, RandIt2 last2,
+                               RandIt3 dest, Compare comp, MergeFunc merge_func) {
+            const std::ptrdiff_t size1 = std::distance(first1, last1);
+            const std::ptrdiff_t size2 = std::distance(first2, last2);
 
-            RandIt mid = std::next(first + range_size / 2);
+            run_chunks<void>(policy, size1 + size2, 1, true,
+                             [&](std::ptrdiff_t chunk_begin, std::ptrdiff_t chunk_end) {
+                return [&, chunk_begin, chunk_end]() {
+                    const std::ptrdiff_t begin1 = merge_path_corank(chunk_begin, first1, size1, first2, size2, comp);
+                    const std::ptrdiff_t end1 = merge_path_corank(chunk_end, first1, size1, first2, size2, comp);
+                    merge_func(first1 + begin1, first1 + end1,
+                               first2 + (chunk_begin - begin1), first2 + (chunk_end - end1),
+                               dest + chunk_begin, comp);
+                };
+            });
+            return dest + (size1 + size2);
+        }
 
-            // partition left and right halves in parallel
-            auto left_future = task_pool.submit(std::partition<RandIt, Predicate>, first, mid, pred);
-            RandIt right_mid = std::partition(mid, last, pred);
-            RandIt left_mid = left_future.get();
+        /**
+         * An independent slice of a merge of two sorted runs: [a_first, a_last) and [b_first, b_last) merge to
+         * dest. All are offsets from the start of the range.
+         */
+        struct merge_part {
+            std::ptrdiff_t a_first;
+            std::ptrdiff_t a_last;
+            std::ptrdiff_t b_first;
+            std::ptrdiff_t b_last;
+            std::ptrdiff_t dest;
+        };
 
-            // merge the two partitioned halves
-            auto left_highs_size = std::distance(left_mid, mid);
-            auto right_lows_size = std::distance(mid, right_mid);
-            if (left_highs_size <= right_lows_size) {
-                std::swap_ranges(left_mid, mid, right_mid - left_highs_size);
-                return right_mid - left_highs_size;
-            } else {
-                std::swap_ranges(mid, right_mid, left_mid);
-                return left_mid + right_lows_size;
-            }
+        /**
+         * An output iterator that discards what is written to it and counts the writes.
+         */
+        class counting_output_iterator {
+        public:
+            using iterator_category = std::output_iterator_tag;
+            using value_type = void;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = void;
+
+            counting_output_iterator& operator*() { return *this; }
+            template <class T>
+            counting_output_iterator& operator=(const T&) { return *this; }
+            counting_output_iterator& operator++() { ++count_; return *this; }
+            counting_output_iterator operator++(int) { counting_output_iterator ret = *this; ++count_; return ret; }
+
+            std::ptrdiff_t count() const { return count_; }
+
+        private:
+            std::ptrdiff_t count_ = 0;
+        };
+
+        /*
+         * The sequential set algorithms as function objects, so one can be called with both the real output
+         * iterator and a counting_output_iterator.
+         */
+#define POOLSTL_DEFINE_SET_OP(NAME)                                                                             \
+        struct NAME##_op {                                                                                      \
+            template <class InIt1, class InIt2, class OutIt, class Compare>                                     \
+            OutIt operator()(InIt1 first1, InIt1 last1, InIt2 first2, InIt2 last2, OutIt dest,                  \
+                             Compare& comp) const {                                                             \
+                return std::NAME(first1, last1, first2, last2, dest, comp);                                     \
+            }                                                                                                   \
+        };
+        POOLSTL_DEFINE_SET_OP(set_union)
+        POOLSTL_DEFINE_SET_OP(set_intersection)
+        POOLSTL_DEFINE_SET_OP(set_difference)
+        POOLSTL_DEFINE_SET_OP(set_symmetric_difference)
+#undef POOLSTL_DEFINE_SET_OP
+
+        /**
+         * Split two sorted ranges A and B into about `max_parts` slices of similar total size. Slices are
+         * merge_part with dest left zero.
+         *
+         * Every split point is the lower bound of the same key in both ranges, so all elements equivalent to one
+         * another land in the same slice. A set algorithm run on each slice therefore produces exactly its share
+         * of the sequential result, including multiset semantics. Splits are found by co-ranking and then moved
+         * down to the start of their key, so long runs of equivalent elements make slices uneven.
+         */
+        template <class RandIt1, class RandIt2, class Compare>
+        std::vector<merge_part> plan_key_aligned_parts(RandIt1 a, std::ptrdiff_t a_size,
+                                                       RandIt2 b, std::ptrdiff_t b_size,
+                                                       std::size_t max_parts, Compare& comp) {
+            const std::ptrdiff_t size = a_size + b_size;
+            std::vector<merge_part> parts;
+            std::ptrdiff_t prev_a = 0;
+            std::ptrdiff_t prev_b = 0;
+            for (std::size_t part = 1; part <= max_parts; ++part) {
+                std::ptrdiff_t split_a = a_size;
+                std::ptrdiff_t split_b = b_size;
+                if (part < max_parts) {
+                    const std::ptrdiff_t rank = (std::ptrdiff_t)(size * part / max_parts);
+                    const std::ptrdiff_t i = merge_path_corank(rank, a, a_size, b, b_size, comp);
+                    const std::ptrdiff_t j = rank - i;
+                    if (j == b_size || (i < a_size && !comp(b[j], a[i]))) {
+                        // The next merged element is a[i]. B's elements before j are less than it.
+                        split_a = std::lower_bound(a, a + i, a[i], comp) - a;
+                        split_b = j;
+                    } else {
+                        split_a = std::lower_bound(a, a + i, b[j], comp) - a;
+                        split_b = std::lower_bound(b, b + j, b[j], comp) - b;
+                    }
+                }
+                if (split_a != prev_a || split_b != prev_b) {
+                    parts.push_back({prev_a, split_a, prev_b, split_b, 0});
+                    prev_a = split_a;
+                    prev_b = split_b;
+                }
+            }
+            return parts;
+        }
+
+        /**
+         * Run a set algorithm (set_union_op, etc.) on sorted [first1, last1) and [first2, last2) in parallel.
+         *
+         * The inputs are split into key-aligned slices. A counting pass runs the algorithm on each slice to size
+         * its output, a scan of the counts gives each slice its place in dest, and a second pass writes the
+         * output. The result is identical to the sequential algorithm.
+         */
+        template <class ExecPolicy, class RandIt1, class RandIt2, class RandIt3, class Compare, class SetOp>
+        RandIt3 parallel_set_op(ExecPolicy &&policy, RandIt1 first1, RandIt1 last1, RandIt2 first2, RandIt2 last2,
+                                RandIt3 dest, Compare comp, SetOp set_op) {
+            auto& task_pool = *policy.pool();
+            const std::ptrdiff_t size1 = std::distance(first1, last1);
+            const std::ptrdiff_t size2 = std::distance(first2, last2);
+            const std::ptrdiff_t max_parts = std::min((std::ptrdiff_t)task_pool.get_num_threads(),
+                                                      (size1 + size2) / merge_split_min_size);
+            if (max_parts < 2) {
+                return set_op(first1, last1, first2, last2, dest, comp);
+            }
+
+            std::vector<merge_part> parts = plan_key_aligned_parts(first1, size1, first2, size2,
+                                                                   (std::size_t)max_parts, comp);
+            parallel_for_each_index(task_pool, parts.size(), [&](std::size_t i) {
+                merge_part& part = parts[i];
+                part.dest = set_op(first1 + part.a_first, first1 + part.a_last,
+                                   first2 + part.b_first, first2 + part.b_last,
+                                   counting_output_iterator(), comp).count();
+            });
+
+            std::ptrdiff_t pos = 0;
+            for (merge_part& part : parts) {
+                const std::ptrdiff_t count = part.dest;
+                part.dest = pos;
+                pos += count;
+            }
+
+            parallel_for_each_index(task_pool, parts.size(), [&](std::size_t i) {
+                const merge_part& part = parts[i];
+                set_op(first1 + part.a_first, first1 + part.a_last,
+                       first2 + part.b_first, first2 + part.b_last,
+                       dest + part.dest, comp);
+            });
+            return dest + pos;
+        }
+
+        /**
+         * Parallel std::includes. Checks each key-aligned slice independently.
+         */
+        template <class ExecPolicy, class RandIt1, class RandIt2, class Compare>
+        bool parallel_includes(ExecPolicy &&policy, RandIt1 first1, RandIt1 last1, RandIt2 first2, RandIt2 last2,
+                               Compare comp) {
+            auto& task_pool = *policy.pool();
+            const std::ptrdiff_t size1 = std::distance(first1, last1);
+            const std::ptrdiff_t size2 = std::distance(first2, last2);
+            if (size2 > size1) {
+                // cannot hold more elements than the range it is included in
+                return false;
+            }
+            const std::ptrdiff_t max_parts = std::min((std::ptrdiff_t)task_pool.get_num_threads(),
+                                                      (size1 + size2) / merge_split_min_size);
+            if (max_parts < 2) {
+                return std::includes(first1, last1, first2, last2, comp);
+            }
+
+            std::vector<merge_part> parts = plan_key_aligned_parts(first1, size1, first2, size2,
+                                                                   (std::size_t)max_parts, comp);
+            std::atomic<bool> included{true};
+            parallel_for_each_index(task_pool, parts.size(), [&](std::size_t i) {
+                const merge_part& part = parts[i];
+                if (included.load(std::memory_order_relaxed) &&
+                    !std::includes(first1 + part.a_first, first1 + part.a_last,
+                                   first2 + part.b_first, first2 + part.b_last, comp)) {
+                    included.store(false, std::memory_order_relaxed);
+                }
+            });
+            return included.load();
+        }
+
+        /**
+         * Split the merge of each pair of adjacent sorted runs of src into parts by co-ranking. An odd run out
+         * becomes a part with nothing to merge with.
+         *
+         * @param runs Start offset of each run, followed by the end offset of the last run.
+         * @param max_parts Split into about this many parts in total. Parts are not smaller than
+         *                  merge_split_min_size.
+         */
+        template <class RandIt, class Compare>
+        std::vector<merge_part> plan_merge_parts(RandIt src, const std::vector<std::ptrdiff_t>& runs,
+                                                 std::size_t max_parts, Compare& comp) {
+            const std::size_t num_runs = runs.size() - 1;
+            const std::size_t num_merges = (num_runs + 1) / 2;
+            const std::ptrdiff_t parts_per_merge = (std::ptrdiff_t)((max_parts + num_merges - 1) / num_merges);
+
+            std::vector<merge_part> parts;
+            for (std::size_t m = 0; m < num_merges; ++m) {
+                const std::ptrdiff_t a = runs[2 * m];
+                const std::ptrdiff_t b = runs[std::min(2 * m + 1, num_runs)];
+                const std::ptrdiff_t b_end = runs[std::min(2 * m + 2, num_runs)];
+                const std::ptrdiff_t merge_size = b_end - a;
+                const std::ptrdiff_t num_parts = std::max(std::min(parts_per_merge,
+                                                                   merge_size / merge_split_min_size),
+                                                          (std::ptrdiff_t)1);
+                const std::ptrdiff_t part_size = (merge_size + num_parts - 1) / num_parts;
+
+                std::ptrdiff_t prev_rank = 0;
+                std::ptrdiff_t prev_split = 0;
+                for (std::ptrdiff_t part = 1; part <= num_parts; ++part) {
+                    const std::ptrdiff_t rank = std::min(part * part_size, merge_size);
+                    const std::ptrdiff_t split = merge_path_corank(rank, src + a, b - a, src + b, b_end - b, comp);
+                    parts.push_back({a + prev_split, a + split,
+                                     b + (prev_rank - prev_split), b + (rank - split),
+                                     a + prev_rank});
+                    prev_rank = rank;
+                    prev_split = split;
+                }
+            }
+            return parts;
+        }
+
+        /**
+         * Move-merge each part from src to dest, in parallel.
+         *
+         * Every part is merged even if comp throws in another, so dest holds every element of src before the
+         * exception is rethrown.
+         */
+        template <class SrcIt, class DstIt, class Compare>
+        void parallel_move_merge_parts(task_thread_pool::task_thread_pool& task_pool, SrcIt src, DstIt dest,
+                                       const std::vector<merge_part>& parts, Compare& comp) {
+            parallel_for_each_index(task_pool, parts.size(), [&](std::size_t i) {
+                const merge_part& part = parts[i];
+                move_merge(src + part.a_first, src + part.a_last, src + part.b_first, src + part.b_last,
+                           dest + part.dest, comp);
+            });
+        }
+
+        /**
+         * Destroy the elements of a scratch buffer, split at `bounds`, in parallel.
+         */
+        template <class T>
+        void parallel_destroy(task_thread_pool::task_thread_pool& task_pool, T* buf,
+                              const std::vector<std::ptrdiff_t>& bounds) {
+            if (std::is_trivially_destructible<T>::value) {
+                return;
+            }
+            parallel_for_each_index(task_pool, bounds.size() - 1, [&](std::size_t part) {
+                for (T* p = buf + bounds[part]; p != buf + bounds[part + 1]; ++p) {
+                    p->~T();
+                }
+            });
+        }
+
+        /**
+         * Merge [first, middle) and [middle, last) in place, in parallel, using a scratch buffer.
+         *
+         * The merge is split into one part per thread by co-ranking. Both halves are then moved to the buffer and
+         * the parts are merged back into the range in parallel.
+         *
+         * Moving elements must not throw. If comp throws, every element is still moved back into the range before
+         * the exception is rethrown.
+         */
+        template <class ExecPolicy, class RandIt, class Compare>
+        void parallel_buffered_inplace_merge(ExecPolicy &&policy, RandIt first, RandIt middle, RandIt last,
+                                             Compare comp) {
+            using T = typename std::iterator_traits<RandIt>::value_type;
+            auto& task_pool = *policy.pool();
+            const std::ptrdiff_t num_steps = last - first;
+            if (first == middle || middle == last) {
+                return;
+            }
+            if (task_pool.get_num_threads() < 2 || num_steps < merge_split_min_size) {
+                std::inplace_merge(first, middle, last, comp);
+                return;
+            }
+
+            // Plan the parts before anything is moved. Each part then moves its own slices.
+            const std::vector<std::ptrdiff_t> runs = {0, (std::ptrdiff_t)(middle - first), num_steps};
+            const std::vector<merge_part> parts = plan_merge_parts(first, runs, task_pool.get_num_threads(), comp);
+            std::vector<std::ptrdiff_t> bounds;
+            for (const merge_part& part : parts) {
+                bounds.push_back(part.dest);
+            }
+            bounds.push_back(num_steps);
+
+            temp_buffer<T> buffer((std::size_t)num_steps);
+            T* temp = buffer.data();
+            parallel_for_each_index(task_pool, parts.size(), [&](std::size_t i) {
+                for (std::ptrdiff_t j = bounds[i]; j < bounds[i + 1]; ++j) {
+                    ::new (static_cast<void*>(temp + j)) T(std::move(first[j]));
+                }
+            });
+
+            try {
+                parallel_move_merge_parts(task_pool, temp, first, parts, comp);
+            } catch (...) {
+                parallel_destroy(task_pool, temp, bounds);
+                throw;
+            }
+            parallel_destroy(task_pool, temp, bounds);
+        }
+
+        /**
+         * Stable sort a range in parallel, using a scratch buffer.
+         *
+         * The range is moved to the buffer in one run per thread, and each run is sorted there with
+         * std::stable_sort. Pairs of adjacent runs are then merged back and forth between the buffer and the range
+         * until one run is left. Each merge is split into parts by co-ranking, so every round uses all threads.
+         *
+         * Moving elements must not throw. If comp throws, every element is still moved back into the range before
+         * the exception is rethrown.
+         */
+        template <class ExecPolicy, class RandIt, class Compare>
+        void parallel_stable_sort(ExecPolicy &&policy, RandIt first, RandIt last, Compare comp) {
+            using T = typename std::iterator_traits<RandIt>::value_type;
+            auto& task_pool = *policy.pool();
+            const std::size_t num_threads = task_pool.get_num_threads();
+            const std::ptrdiff_t num_steps = std::distance(first, last);
+
+            const std::ptrdiff_t max_runs = std::min((std::ptrdiff_t)num_threads, num_steps / merge_split_min_size);
+            if (max_runs < 2) {
+                std::stable_sort(first, last, comp);
+                return;
+            }
+            const std::ptrdiff_t run_size = (num_steps + max_runs - 1) / max_runs;
+            std::vector<std::ptrdiff_t> runs;
+            for (std::ptrdiff_t run = 0; run < num_steps; run += run_size) {
+                runs.push_back(run);
+            }
+            runs.push_back(num_steps);
+            // The initial runs also split moving elements out of and back into the range.
+            const std::vector<std::ptrdiff_t> chunks(runs);
+
+            temp_buffer<T> buffer((std::size_t)num_steps);
+            T* temp = buffer.data();
+            std::exception_ptr error;
+            try {
+                parallel_for_each_index(task_pool, chunks.size() - 1, [&](std::size_t c) {
+                    for (std::ptrdiff_t i = chunks[c]; i < chunks[c + 1]; ++i) {
+                        ::new (static_cast<void*>(temp + i)) T(std::move(first[i]));
+                    }
+                    std::stable_sort(temp + chunks[c], temp + chunks[c + 1], comp);
+                });
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            bool in_buffer = true;
+            while (!error && runs.size() > 2) {
+                std::vector<merge_part> parts;
+                try {
+                    parts = in_buffer ? plan_merge_parts(temp, runs, num_threads, comp)
+                                      : plan_merge_parts(first, runs, num_threads, comp);
+                } catch (...) {
+                    error = std::current_exception();
+                    break;
+                }
+
+                try {
+                    if (in_buffer) {
+                        parallel_move_merge_parts(task_pool, temp, first, parts, comp);
+                    } else {
+                        parallel_move_merge_parts(task_pool, first, temp, parts, comp);
+                    }
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                in_buffer = !in_buffer;
+
+                std::vector<std::ptrdiff_t> merged_runs;
+                for (std::size_t r = 0; r + 1 < runs.size(); r += 2) {
+                    merged_runs.push_back(runs[r]);
+                }
+                merged_runs.push_back(num_steps);
+                runs.swap(merged_runs);
+            }
+
+            parallel_for_each_index(task_pool, chunks.size() - 1, [&](std::size_t c) {
+                T* chunk_first = temp + chunks[c];
+                T* chunk_last = temp + chunks[c + 1];
+                if (in_buffer) {
+                    std::move(chunk_first, chunk_last, first + chunks[c]);
+                }
+                for (T* p = chunk_first; p != chunk_last; ++p) {
+                    p->~T();
+                }
+            });
+
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        /**
+         * Merge [first, middle) and [middle, last) in place, split into up to `num_parts` parallel merges.
+         *
+         * The output midpoint is co-ranked to find the elements of each input that belong in the first half.
+         * Rotating the two middle blocks then leaves two independent merges, which recurse in parallel.
+         *
+         * @param merge_func Sequential merge method, like std::inplace_merge
+         */
+        template <class RandIt, class Compare, class MergeFunc>
+        void parallel_inplace_merge(task_thread_pool::task_thread_pool& task_pool,
+                                    RandIt first, RandIt middle, RandIt last,
+                                    Compare& comp, MergeFunc merge_func, std::size_t num_parts) {
+            const std::ptrdiff_t a_size = middle - first;
+            const std::ptrdiff_t b_size = last - middle;
+            if (a_size == 0 || b_size == 0) {
+                return;
+            }
+            if (num_parts < 2 || last - first < merge_split_min_size) {
+                merge_func(first, middle, last, comp);
+                return;
+            }
+
+            const std::ptrdiff_t rank = (last - first) / 2;
+            const std::ptrdiff_t a_lo = merge_path_corank(rank, first, a_size, middle, b_size, comp);
+            const std::ptrdiff_t b_lo = rank - a_lo;
+
+            // [first + a_lo, middle) holds A's high part, [middle, middle + b_lo) B's low part. Swap them.
+            parallel_rotate(task_pool, first + a_lo, middle, middle + b_lo, num_parts);
+
+            const RandIt split = first + rank;
+            const std::size_t left_parts = num_parts / 2;
+            chunk_job<void> job(&task_pool, 2);
+            try {
+                spawn_chunk(task_pool, job, false, [&, left_parts]() {
+                    parallel_inplace_merge(task_pool, first, first + a_lo, split, comp, merge_func, left_parts);
+                });
+                spawn_chunk(task_pool, job, true, [&, left_parts]() {
+                    parallel_inplace_merge(task_pool, split, split + (a_size - a_lo), last, comp, merge_func,
+                                           num_parts - left_parts);
+                });
+            } catch (...) {
+                job.latch.set_exception(std::current_exception());
+            }
+            job.latch.wait();
+        }
+
+        /**
+         * Sort a range in parallel.
+         *
+         * @param sort_func Sequential sort method, like std::sort or std::stable_sort
+         * @param merge_func Sequential merge method, like std::inplace_merge
+         */
+        template <class ExecPolicy, class RandIt, class Compare, class SortFunc, class MergeFunc>
+        void parallel_mergesort(ExecPolicy &&policy, RandIt first, RandIt last,
+                                Compare comp, SortFunc sort_func, MergeFunc merge_func) {
+            if (first == last) {
+                return;
+            }
+
+            // Sort chunks in parallel
+            using SortedRange = std::pair<RandIt, RandIt>;
+            auto sorted = parallel_chunk_for_gen(std::forward<ExecPolicy>(policy), first, last,
+                             [&comp, sort_func] (RandIt chunk_first, RandIt chunk_last) {
+                                 sort_func(chunk_first, chunk_last, comp);
+                                 return std::make_pair(chunk_first, chunk_last);
+                             });
+            std::vector<SortedRange> subranges(sorted.begin(), sorted.end());
+
+            // Merge pairs of adjacent sorted ranges until one is left. Each merge is split so that every round
+            // uses all threads.
+            auto& task_pool = *policy.pool();
+            while (subranges.size() > 1) {
+                const std::size_t num_merges = subranges.size() / 2;
+                const std::size_t parts_per_merge = (task_pool.get_num_threads() + num_merges - 1) / num_merges;
+                chunk_job<void> job(&task_pool, num_merges);
+
+                try {
+                    for (std::size_t i = 0; i < num_merges; ++i) {
+                        const SortedRange lhs = subranges[2 * i];
+                        const SortedRange rhs = subranges[2 * i + 1];
+                        spawn_chunk(task_pool, job, i + 1 == num_merges,
+                                    std::bind([&task_pool, &comp, merge_func, parts_per_merge] (RandIt chunk_first,
+                                                                   RandIt chunk_middle, RandIt chunk_last) {
+                                        parallel_inplace_merge(task_pool, chunk_first, chunk_middle, chunk_last,
+                                                               comp, merge_func, parts_per_merge);
+                                    }, lhs.first, lhs.second, rhs.second));
+                        subranges[i] = SortedRange(lhs.first, rhs.second);
+                    }
+                } catch (...) {
+                    job.latch.set_exception(std::current_exception());
+                }
+
+                // An odd range out is carried to the next round as-is.
+                if (subranges.size() % 2 == 1) {
+                    subranges[num_merges] = subranges.back();
+                    subranges.resize(num_merges + 1);
+                } else {
+                    subranges.resize(num_merges);
+                }
+
+                job.latch.wait();
+            }
+        }
+
+        /**
+         * Quicksort worker function.
+         */
+        template <class RandIt, class Compare, class SortFunc, class PartFunc, class PivotFunc>
+        void quicksort_impl(task_thread_pool::task_thread_pool* task_pool, const RandIt first, const RandIt last,
+                            Compare comp, SortFunc sort_func, PartFunc part_func, PivotFunc pivot_func,
+                            std::ptrdiff_t target_leaf_size,
+                            std::vector<pooled_future<void>>* futures, std::mutex* mutex,
+                            std::condition_variable* cv, int* inflight_spawns) {
+            using T = typename std::iterator_traits<RandIt>::value_type;
+
+            auto partition_size = std::distance(first, last);
+
+            if (partition_size > target_leaf_size) {
+                // partition the range
+                auto mid = part_func(first, last, pivot_predicate<Compare, T>(comp, pivot_func(first, last)));
+
+                if (mid != first && mid != last) {
+                    // was able to partition the range, so recurse
+                    std::lock_guard<std::mutex> guard(*mutex);
+                    ++(*inflight_spawns);
+
+                    futures->emplace_back(submit_pooled(*task_pool,
+                        quicksort_impl<RandIt, Compare, SortFunc, PartFunc, PivotFunc>,
+                        task_pool, first, mid, comp, sort_func, part_func, pivot_func, target_leaf_size,
+                        futures, mutex, cv, inflight_spawns));
+
+                    futures->emplace_back(submit_pooled(*task_pool,
+                        quicksort_impl<RandIt, Compare, SortFunc, PartFunc, PivotFunc>,
+                        task_pool, mid, last, comp, sort_func, part_func, pivot_func, target_leaf_size,
+                        futures, mutex, cv, inflight_spawns));
+                    return;
+                }
+            }
+
+            // Range does not need to be subdivided (or was unable to subdivide). Run the sequential sort.
+            {
+                // notify main thread that partitioning may be finished
+                std::lock_guard<std::mutex> guard(*mutex);
+                --(*inflight_spawns);
+            }
+            cv->notify_one();
+
+            sort_func(first, last, comp);
+        }
+
+        /**
+         * Sort a range in parallel using quicksort.
+         *
+         * @param sort_func Sequential sort method, like std::sort or std::stable_sort
+         * @param part_func Method that partitions a range, like std::partition or std::stable_partition
+         * @param pivot_func Method that identifies the pivot
+         */
+        template <class ExecPolicy, class RandIt, class Compare, class SortFunc, class PartFunc, class PivotFunc>
+        void parallel_quicksort(ExecPolicy &&policy, RandIt first, RandIt last,
+                                Compare comp, SortFunc sort_func, PartFunc part_func, PivotFunc pivot_func) {
+            if (first == last) {
+                return;
+            }
+
+            auto& task_pool = *policy.pool();
+
+            // Target partition size. Range will be recursively partitioned into partitions no bigger than this
+            // size. Target approximately twice as many partitions as threads to reduce impact of uneven pivot
+            // selection.
+            auto num_threads = task_pool.get_num_threads();
+            std::ptrdiff_t target_leaf_size = std::max((std::ptrdiff_t)(std::distance(first, last) / (num_threads * 2)),
+                                                       (std::ptrdiff_t)5);
+
+            if (num_threads == 1) {
+                target_leaf_size = std::distance(first, last);
+            }
+
+            // task_thread_pool does not support creating task DAGs, so organize the code such that
+            // all parallel tasks are independent. The parallel tasks can spawn additional parallel tasks, and they
+            // record their "child" task's std::future into a common vector to be waited on by the main thread.
+            std::mutex mutex;
+
+            // Futures of parallel tasks. Access protected by mutex.
+            std::vector<pooled_future<void>> futures;
+
+            // For signaling that all partitioning has been completed and futures vector is complete. Uses mutex.
+            std::condition_variable cv;
+
+            // Number of `quicksort_impl` calls that haven't finished yet. Nonzero value means futures vector may
+            // still be modified. Access protected by mutex.
+            int inflight_spawns = 1;
+
+            // Root task, on the calling thread.
+            task_pool.run_inline([&]() {
+                quicksort_impl(&task_pool, first, last, comp, sort_func, part_func, pivot_func, target_leaf_size,
+                               &futures, &mutex, &cv, &inflight_spawns);
+            });
+
+            // Wait for all partitioning to finish. Help execute the spawned tasks in the meantime.
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wait_helping(&task_pool, lock, cv, [&] { return inflight_spawns == 0; });
+            }
+
+            // Wait on all the parallel tasks.
+            get_futures(futures);
+        }
+
+        /**
+         * Partitions smaller than this many elements per thread are not split between threads.
+         */
+        constexpr std::ptrdiff_t partition_min_chunk_size = 2048;
+
+        /**
+         * Partition range according to predicate, in parallel. Unstable.
+         *
+         * The range is split into one chunk per thread and each chunk is partitioned with std::partition, in
+         * parallel. The chunks' low counts sum to the final partition point. The highs left before that point and
+         * the lows left after it are equal in number; they are swapped in parallel, split evenly between threads.
+         */
+        template <class RandIt, class Predicate>
+        RandIt parallel_partition(task_thread_pool::task_thread_pool &task_pool, RandIt first, RandIt last,
+                                  Predicate pred) {
+            using Block = std::pair<std::ptrdiff_t, std::ptrdiff_t>;
+            const std::ptrdiff_t num_steps = std::distance(first, last);
+            const std::ptrdiff_t num_chunks = std::min((std::ptrdiff_t)task_pool.get_num_threads(),
+                                                       num_steps / partition_min_chunk_size);
+            if (num_chunks < 2) {
+                return std::partition(first, last, pred);
+            }
+
+            // Partition each chunk.
+            const std::ptrdiff_t chunk_size = (num_steps + num_chunks - 1) / num_chunks;
+            std::vector<std::ptrdiff_t> bounds;
+            for (std::ptrdiff_t i = 0; i < num_steps; i += chunk_size) {
+                bounds.push_back(i);
+            }
+            bounds.push_back(num_steps);
+            std::vector<std::ptrdiff_t> mids(bounds.size() - 1);
+            parallel_for_each_index(task_pool, mids.size(), [&](std::size_t c) {
+                mids[c] = std::partition(first + bounds[c], first + bounds[c + 1], pred) - first;
+            });
+
+            std::ptrdiff_t num_lows = 0;
+            for (std::size_t c = 0; c < mids.size(); ++c) {
+                num_lows += mids[c] - bounds[c];
+            }
+
+            // Find the misplaced blocks: each chunk's highs before num_lows and its lows after it.
+            std::vector<Block> highs;
+            std::vector<Block> lows;
+            std::ptrdiff_t num_misplaced = 0;
+            for (std::size_t c = 0; c < mids.size(); ++c) {
+                if (mids[c] < std::min(bounds[c + 1], num_lows)) {
+                    highs.emplace_back(mids[c], std::min(bounds[c + 1], num_lows));
+                    num_misplaced += highs.back().second - highs.back().first;
+                }
+                if (std::max(bounds[c], num_lows) < mids[c]) {
+                    lows.emplace_back(std::max(bounds[c], num_lows), mids[c]);
+                }
+            }
+            if (num_misplaced == 0) {
+                return first + num_lows;
+            }
+
+            // Swap the k-th misplaced high with the k-th misplaced low.
+            const std::ptrdiff_t max_parts = std::max(std::min((std::ptrdiff_t)task_pool.get_num_threads(),
+                                                               num_misplaced / partition_min_chunk_size),
+                                                      (std::ptrdiff_t)1);
+            const std::ptrdiff_t part_size = (num_misplaced + max_parts - 1) / max_parts;
+            const std::ptrdiff_t num_parts = (num_misplaced + part_size - 1) / part_size;
+
+            // Find the position of the k-th misplaced element in a list of blocks, and the block it is in.
+            auto locate = [](const std::vector<Block>& blocks, std::ptrdiff_t k, std::size_t& block) {
+                for (block = 0; k >= blocks[block].second - blocks[block].first; ++block) {
+                    k -= blocks[block].second - blocks[block].first;
+                }
+                return blocks[block].first + k;
+            };
+
+            parallel_for_each_index(task_pool, (std::size_t)num_parts, [&](std::size_t part) {
+                std::ptrdiff_t remaining = std::min(part_size, num_misplaced - (std::ptrdiff_t)part * part_size);
+
+                std::size_t hi;
+                std::size_t li;
+                std::ptrdiff_t h_pos = locate(highs, (std::ptrdiff_t)part * part_size, hi);
+                std::ptrdiff_t l_pos = locate(lows, (std::ptrdiff_t)part * part_size, li);
+                while (remaining > 0) {
+                    const std::ptrdiff_t len = std::min(std::min(highs[hi].second - h_pos, lows[li].second - l_pos),
+                                                        remaining);
+                    std::swap_ranges(first + h_pos, first + h_pos + len, first + l_pos);
+                    remaining -= len;
+                    h_pos += len;
+                    l_pos += len;
+                    if (h_pos == highs[hi].second && hi + 1 < highs.size()) {
+                        h_pos = highs[++hi].first;
+                    }
+                    if (l_pos == lows[li].second && li + 1 < lows.size()) {
+                        l_pos = lows[++li].first;
+                    }
+                }
+            });
+
+            return first + num_lows;
+        }
+
+        /**
+         * Elements sampled to choose each quickselect pivot.
+         */
+        constexpr std::ptrdiff_t quickselect_sample_size = 63;
+
+        /**
+         * Parallel std::nth_element: a quickselect whose partitions use parallel_partition().
+         *
+         * Each round takes the pivot from an evenly spaced sample, at the sample rank that corresponds to nth's rank
+         * in the range, then partitions three ways into less than, equivalent to and greater than the pivot. The
+         * pivot is an element of the range, so every round shrinks it. Once the range is too small to partition in
+         * parallel, std::nth_element finishes.
+         */
+        template <class ExecPolicy, class RandIt, class Compare>
+        void parallel_nth_element(ExecPolicy &&policy, RandIt first, RandIt nth, RandIt last, Compare comp) {
+            using T = typename std::iterator_traits<RandIt>::value_type;
+            auto& task_pool = *policy.pool();
+            const std::ptrdiff_t num_threads = (std::ptrdiff_t)task_pool.get_num_threads();
+
+            std::vector<T> sample;
+            while (nth != last && std::min(num_threads, (last - first) / partition_min_chunk_size) >= 2) {
+                const std::ptrdiff_t size = last - first;
+                sample.clear();
+                for (std::ptrdiff_t i = 0; i < quickselect_sample_size; ++i) {
+                    sample.push_back(first[(2 * i + 1) * size / (2 * quickselect_sample_size)]);
+                }
+                auto sample_nth = sample.begin() + (nth - first) * quickselect_sample_size / size;
+                std::nth_element(sample.begin(), sample_nth, sample.end(), comp);
+                const T pivot = *sample_nth;
+
+                RandIt less_last = parallel_partition(task_pool, first, last,
+                                                      pivot_predicate<Compare, T>(comp, pivot));
+                if (nth < less_last) {
+                    last = less_last;
+                    continue;
+                }
+                RandIt equal_last = parallel_partition(task_pool, less_last, last,
+                    [comp, &pivot](const T& em) mutable { return !comp(pivot, em); });
+                if (nth < equal_last) {
+                    // nth is equivalent to the pivot
+                    return;
+                }
+                first = equal_last;
+            }
+
+            std::nth_element(first, nth, last, comp);
+        }
+
+        /**
+         * Copy the `num_out` smallest elements of [first, last) to dest in parallel, in unspecified order.
+         *
+         * The input is split into one chunk per thread, and each chunk keeps a heap of its own num_out smallest
+         * elements in a scratch buffer. Only these candidates are copied, never the whole input. The smallest
+         * num_out candidates are then selected with parallel_nth_element() and moved to dest.
+         *
+         * @param num_out At least 1 and at most the size of the input.
+         * @return The end of the output.
+         */
+        template <class ExecPolicy, class RandIt1, class RandIt2, class Compare>
+        RandIt2 parallel_select_copy(ExecPolicy &&policy, RandIt1 first, RandIt1 last, RandIt2 dest,
+                                     std::ptrdiff_t num_out, Compare comp) {
+            using T = typename std::iterator_traits<RandIt1>::value_type;
+            auto& task_pool = *policy.pool();
+            const std::ptrdiff_t num_steps = std::distance(first, last);
+            const std::ptrdiff_t num_chunks = std::max(std::min((std::ptrdiff_t)task_pool.get_num_threads(),
+                                                                num_steps / partition_min_chunk_size),
+                                                       (std::ptrdiff_t)1);
+            auto chunk_begin = [&](std::ptrdiff_t c) { return c * num_steps / num_chunks; };
+
+            // Chunk c's candidates are [bounds[c], bounds[c + 1]) in the buffer.
+            std::vector<std::ptrdiff_t> bounds = {0};
+            for (std::ptrdiff_t c = 0; c < num_chunks; ++c) {
+                bounds.push_back(bounds.back() + std::min(chunk_begin(c + 1) - chunk_begin(c), num_out));
+            }
+            const std::ptrdiff_t num_candidates = bounds.back();
+
+            temp_buffer<T> buffer((std::size_t)num_candidates);
+            T* temp = buffer.data();
+            std::vector<char> constructed((std::size_t)num_chunks, 0);
+            try {
+                parallel_for_each_index(task_pool, (std::size_t)num_chunks, [&](std::size_t c) {
+                    RandIt1 chunk_first = first + chunk_begin((std::ptrdiff_t)c);
+                    RandIt1 chunk_last = first + chunk_begin((std::ptrdiff_t)c + 1);
+                    T* heap = temp + bounds[c];
+                    const std::ptrdiff_t heap_size = bounds[c + 1] - bounds[c];
+                    std::uninitialized_copy(chunk_first, chunk_first + heap_size, heap);
+                    constructed[c] = 1;
+
+                    // The heap's top is the largest of the smallest elements seen so far.
+                    std::make_heap(heap, heap + heap_size, comp);
+                    for (RandIt1 it = chunk_first + heap_size; it != chunk_last; ++it) {
+                        if (comp(*it, *heap)) {
+                            std::pop_heap(heap, heap + heap_size, comp);
+                            heap[heap_size - 1] = *it;
+                            std::push_heap(heap, heap + heap_size, comp);
+                        }
+                    }
+                });
+
+                if (num_out < num_candidates) {
+                    parallel_nth_element(policy, temp, temp + num_out, temp + num_candidates, comp);
+                }
+                parallel_for_each_index(task_pool, (std::size_t)num_chunks, [&](std::size_t c) {
+                    const std::ptrdiff_t out_first = (std::ptrdiff_t)c * num_out / num_chunks;
+                    const std::ptrdiff_t out_last = ((std::ptrdiff_t)c + 1) * num_out / num_chunks;
+                    std::move(temp + out_first, temp + out_last, dest + out_first);
+                });
+            } catch (...) {
+                for (std::ptrdiff_t c = 0; c < num_chunks; ++c) {
+                    if (constructed[(std::size_t)c]) {
+                        for (T* p = temp + bounds[c]; p != temp + bounds[c + 1]; ++p) {
+                            p->~T();
+                        }
+                    }
+                }
+                throw;
+            }
+            parallel_destroy(task_pool, temp, bounds);
+            return dest + num_out;
+        }
+
+        /**
+         * A chunk of a stream compaction. Bounds are offsets into the input.
+         */
+        struct compaction_chunk {
+            std::ptrdiff_t first;
+            std::ptrdiff_t last;
+            // Number of elements in the chunk that satisfy the predicate.
+            std::ptrdiff_t num_selected;
+            // Output positions of the chunk's first selected and first rejected elements, counting each kind
+            // separately.
+            std::ptrdiff_t selected_pos;
+            std::ptrdiff_t rejected_pos;
+        };
+
+        /**
+         * First pass of a parallel stream compaction. Evaluates `is_selected(i)` for each element offset i in parallel
+         * chunks and stores the result in selected[i].
+         *
+         * @return The chunks, in order, with each chunk's output positions. Scattering each chunk to its positions
+         *         preserves the relative order of selected and of rejected elements.
+         */
+        template <class ExecPolicy, class RandIt, class Classify>
+        std::vector<compaction_chunk> parallel_classify(ExecPolicy &&policy, RandIt first, RandIt last,
+                                                        Classify is_selected, std::uint8_t* selected) {
+            auto results = parallel_chunk_for_gen(std::forward<ExecPolicy>(policy), first, last,
+                [first, is_selected, selected](RandIt chunk_first, RandIt chunk_last) mutable {
+                    compaction_chunk chunk = {chunk_first - first, chunk_last - first, 0, 0, 0};
+                    for (std::ptrdiff_t i = chunk.first; i < chunk.last; ++i) {
+                        const bool sel = is_selected(i);
+                        selected[i] = sel;
+                        chunk.num_selected += sel;
+                    }
+                    return chunk;
+                });
+
+            std::vector<compaction_chunk> chunks(results.begin(), results.end());
+            std::ptrdiff_t selected_pos = 0;
+            std::ptrdiff_t rejected_pos = 0;
+            for (compaction_chunk& chunk : chunks) {
+                chunk.selected_pos = selected_pos;
+                chunk.rejected_pos = rejected_pos;
+                selected_pos += chunk.num_selected;
+                rejected_pos += (chunk.last - chunk.first) - chunk.num_selected;
+            }
+            return chunks;
+        }
+
+        /**
+         * Copy the elements whose offsets satisfy is_selected to dest in parallel, preserving relative order.
+         */
+        template <class ExecPolicy, class RandIt1, class RandIt2, class Classify>
+        RandIt2 parallel_copy_selected(ExecPolicy &&policy, RandIt1 first, RandIt1 last, RandIt2 dest,
+                                       Classify is_selected) {
+            const std::ptrdiff_t num_steps = std::distance(first, last);
+            if (num_steps == 0) {
+                return dest;
+            }
+            auto& task_pool = *policy.pool();
+
+            std::unique_ptr<std::uint8_t[]> selected(new std::uint8_t[(std::size_t)num_steps]);
+            auto chunks = parallel_classify(std::forward<ExecPolicy>(policy), first, last, is_selected,
+                                            selected.get());
+
+            parallel_for_each_index(task_pool, chunks.size(), [&](std::size_t c) {
+                const compaction_chunk& chunk = chunks[c];
+                RandIt2 out = dest + chunk.selected_pos;
+                for (std::ptrdiff_t i = chunk.first; i < chunk.last; ++i) {
+                    if (selected[(std::size_t)i]) {
+                        *out = first[i];
+                        ++out;
+                    }
+                }
+            });
+
+            return dest + (chunks.back().selected_pos + chunks.back().num_selected);
+        }
+
+        /**
+         * Move the elements whose offsets satisfy is_selected to the front of the range in parallel, preserving
+         * relative order. The selected elements pass through a scratch buffer, so moving elements must not throw.
+         * is_selected is evaluated before anything is moved.
+         *
+         * @return The end of the selected elements. Elements past it are valid but unspecified.
+         */
+        template <class ExecPolicy, class RandIt, class Classify>
+        RandIt parallel_keep_selected(ExecPolicy &&policy, RandIt first, RandIt last, Classify is_selected) {
+            using T = typename std::iterator_traits<RandIt>::value_type;
+            const std::ptrdiff_t num_steps = std::distance(first, last);
+            if (num_steps == 0) {
+                return first;
+            }
+            auto& task_pool = *policy.pool();
+
+            std::unique_ptr<std::uint8_t[]> selected(new std::uint8_t[(std::size_t)num_steps]);
+            auto chunks = parallel_classify(std::forward<ExecPolicy>(policy), first, last, is_selected,
+                                            selected.get());
+            const std::ptrdiff_t num_selected = chunks.back().selected_pos + chunks.back().num_selected;
+            if (num_selected == num_steps) {
+                return last;
+            }
+
+            temp_buffer<T> buffer((std::size_t)num_selected);
+            T* temp = buffer.data();
+            parallel_for_each_index(task_pool, chunks.size(), [&](std::size_t c) {
+                const compaction_chunk& chunk = chunks[c];
+                T* out = temp + chunk.selected_pos;
+                for (std::ptrdiff_t i = chunk.first; i < chunk.last; ++i) {
+                    if (selected[(std::size_t)i]) {
+                        ::new (static_cast<void*>(out)) T(std::move(first[i]));
+                        ++out;
+                    }
+                }
+            });
+            // move back in the same output slices
+            parallel_for_each_index(task_pool, chunks.size(), [&](std::size_t c) {
+                T* chunk_first = temp + chunks[c].selected_pos;
+                T* chunk_last = chunk_first + chunks[c].num_selected;
+                std::move(chunk_first, chunk_last, first + chunks[c].selected_pos);
+                for (T* p = chunk_first; p != chunk_last; ++p) {
+                    p->~T();
+                }
+            });
+
+            return first + num_selected;
+        }
+
+        /**
+         * Copy the elements that satisfy pred to dest in parallel, preserving relative order.
+         */
+        template <class ExecPolicy, class RandIt1, class RandIt2, class Predicate>
+        RandIt2 parallel_copy_if(ExecPolicy &&policy, RandIt1 first, RandIt1 last, RandIt2 dest, Predicate pred) {
+            return parallel_copy_selected(std::forward<ExecPolicy>(policy), first, last, dest,
+                                          [first, pred](std::ptrdiff_t i) mutable { return pred(first[i]); });
+        }
+
+        /**
+         * Parallel std::remove_if. See parallel_keep_selected.
+         */
+        template <class ExecPolicy, class RandIt, class Predicate>
+        RandIt parallel_remove_if(ExecPolicy &&policy, RandIt first, RandIt last, Predicate pred) {
+            return parallel_keep_selected(std::forward<ExecPolicy>(policy), first, last,
+                                          [first, pred](std::ptrdiff_t i) mutable { return !pred(first[i]); });
+        }
+
+        /**
+         * Parallel std::unique. An element is kept if it is the first one or is not equal to its predecessor.
+         * Predecessors are read in place, so duplicates that straddle a chunk boundary are found like any other.
+         */
+        template <class ExecPolicy, class RandIt, class BinaryPredicate>
+        RandIt parallel_unique(ExecPolicy &&policy, RandIt first, RandIt last, BinaryPredicate pred) {
+            return parallel_keep_selected(std::forward<ExecPolicy>(policy), first, last,
+                [first, pred](std::ptrdiff_t i) mutable { return i == 0 || !pred(first[i - 1], first[i]); });
+        }
+
+        /**
+         * Parallel std::unique_copy. See parallel_unique.
+         */
+        template <class ExecPolicy, class RandIt1, class RandIt2, class BinaryPredicate>
+        RandIt2 parallel_unique_copy(ExecPolicy &&policy, RandIt1 first, RandIt1 last, RandIt2 dest,
+                                     BinaryPredicate pred) {
+            return parallel_copy_selected(std::forward<ExecPolicy>(policy), first, last, dest,
+                [first, pred](std::ptrdiff_t i) mutable { return i == 0 || !pred(first[i - 1], first[i]); });
+        }
+
+        /**
+         * Copy the elements that satisfy pred to dest_true and the rest to dest_false, in parallel. Preserves
+         * relative order.
+         *
+         * @return The ends of the two outputs.
+         */
+        template <class ExecPolicy, class RandIt1, class RandIt2, class RandIt3, class Predicate>
+        std::pair<RandIt2, RandIt3> parallel_partition_copy(ExecPolicy &&policy, RandIt1 first, RandIt1 last,
+                                                            RandIt2 dest_true, RandIt3 dest_false, Predicate pred) {
+            const std::ptrdiff_t num_steps = std::distance(first, last);
+            if (num_steps == 0) {
+                return std::make_pair(dest_true, dest_false);
+            }
+            auto& task_pool = *policy.pool();
+
+            std::unique_ptr<std::uint8_t[]> selected(new std::uint8_t[(std::size_t)num_steps]);
+            auto chunks = parallel_classify(std::forward<ExecPolicy>(policy), first, last,
+                                            [first, pred](std::ptrdiff_t i) mutable { return pred(first[i]); },
+                                            selected.get());
+
+            parallel_for_each_index(task_pool, chunks.size(), [&](std::size_t c) {
+                const compaction_chunk& chunk = chunks[c];
+                RandIt2 out_true = dest_true + chunk.selected_pos;
+                RandIt3 out_false = dest_false + chunk.rejected_pos;
+                for (std::ptrdiff_t i = chunk.first; i < chunk.last; ++i) {
+                    if (selected[(std::size_t)i]) {
+                        *out_true = first[i];
+                        ++out_true;
+                    } else {
+                        *out_false = first[i];
+                        ++out_false;
+                    }
+                }
+            });
+
+            const std::ptrdiff_t num_selected = chunks.back().selected_pos + chunks.back().num_selected;
+            return std::make_pair(dest_true + num_selected, dest_false + (num_steps - num_selected));
+        }
+
+        /**
+         * Stable partition in parallel, using a scratch buffer.
+         *
+         * Each parallel chunk moves its elements to their final positions in the buffer, then the buffer is moved
+         * back. Moving elements must not throw. pred is evaluated before anything is moved.
+         */
+        template <class ExecPolicy, class RandIt, class Predicate>
+        RandIt parallel_stable_partition(ExecPolicy &&policy, RandIt first, RandIt last, Predicate pred) {
+            using T = typename std::iterator_traits<RandIt>::value_type;
+            const std::ptrdiff_t num_steps = std::distance(first, last);
+            if (num_steps == 0) {
+                return first;
+            }
+            auto& task_pool = *policy.pool();
+
+            std::unique_ptr<std::uint8_t[]> selected(new std::uint8_t[(std::size_t)num_steps]);
+            auto chunks = parallel_classify(std::forward<ExecPolicy>(policy), first, last,
+                                            [first, pred](std::ptrdiff_t i) mutable { return pred(first[i]); },
+                                            selected.get());
+            const std::ptrdiff_t num_selected = chunks.back().selected_pos + chunks.back().num_selected;
+
+            temp_buffer<T> buffer((std::size_t)num_steps);
+            T* temp = buffer.data();
+            parallel_for_each_index(task_pool, chunks.size(), [&](std::size_t c) {
+                const compaction_chunk& chunk = chunks[c];
+                T* out_true = temp + chunk.selected_pos;
+                T* out_false = temp + num_selected + chunk.rejected_pos;
+                for (std::ptrdiff_t i = chunk.first; i < chunk.last; ++i) {
+                    T*& out = selected[(std::size_t)i] ? out_true : out_false;
+                    ::new (static_cast<void*>(out)) T(std::move(first[i]));
+                    ++out;
+                }
+            });
+            parallel_for_each_index(task_pool, chunks.size(), [&](std::size_t c) {
+                T* chunk_first = temp + chunks[c].first;
+                T* chunk_last = temp + chunks[c].last;
+                std::move(chunk_first, chunk_last, first + chunks[c].first);
+                for (T* p = chunk_first; p != chunk_last; ++p) {
+                    p->~T();
+                }
+            });
+
+            return first + num_selected;
+        }
+
+        /**
+         * Samples taken per samplesort bucket to choose the splitters. More samples give more even buckets.
+         */
+        constexpr std::ptrdiff_t samplesort_oversampling = 32;
+
+        /**
+         * Samplesort buckets per thread. With more buckets than threads, threads that finish early sort more.
+         */
+        constexpr std::ptrdiff_t samplesort_buckets_per_thread = 4;
+
+        /**
+         * Bucket ids are stored in one byte per element.
+         */
+        constexpr std::ptrdiff_t samplesort_max_buckets = 256;
+
+        /**
+         * Smallest average bucket size worth classifying and scattering for.
+         */
+        constexpr std::ptrdiff_t samplesort_min_bucket_size = 1024;
+
+        /**
+         * Sort a range in parallel using samplesort.
+         *
+         * Splitters are chosen from a sorted sample of the input. The input is split into one chunk per thread
+         * and each chunk classifies its elements into the buckets between splitters. The elements are then
+         * moved to their bucket in a scratch buffer, each chunk to its own precomputed offsets, and finally each
+         * bucket is moved back and sorted with sort_func, in parallel.
+         *
+         * If several splitters are equal, elements equal to them get a bucket of their own that needs no sorting.
+         *
+         * Moving elements must not throw. If sort_func throws, every element is still moved back into the range
+         * before the exception is rethrown.
+         *
+         * @param sort_func Sequential sort method, called on each bucket.
+         */
+        template <class ExecPolicy, class RandIt, class Compare, class SortFunc>
+        void parallel_samplesort(ExecPolicy &&policy, RandIt first, RandIt last, Compare comp, SortFunc sort_func) {
+            using T = typename std::iterator_traits<RandIt>::value_type;
+            auto& task_pool = *policy.pool();
+            const std::ptrdiff_t num_steps = std::distance(first, last);
+
+            const std::ptrdiff_t num_buckets = std::min(std::min(
+                (std::ptrdiff_t)task_pool.get_num_threads() * samplesort_buckets_per_thread, samplesort_max_buckets),
+                num_steps / samplesort_min_bucket_size);
+            if (task_pool.get_num_threads() < 2 || num_buckets < 2) {
+                sort_func(first, last, comp);
+                return;
+            }
+
+            // Choose splitters from a sorted sample. Sample positions are jittered within their stride so that
+            // periodic inputs do not bias the sample.
+            const std::ptrdiff_t num_samples = num_buckets * samplesort_oversampling;
+            const std::ptrdiff_t stride = num_steps / num_samples;
+            std::vector<std::ptrdiff_t> sample((std::size_t)num_samples);
+            for (std::ptrdiff_t i = 0; i < num_samples; ++i) {
+                std::uint64_t jitter = ((std::uint64_t)i * 0x9E3779B97F4A7C15ULL) >> 32;
+                sample[(std::size_t)i] = i * stride + (std::ptrdiff_t)(jitter % (std::uint64_t)stride);
+            }
+            std::sort(sample.begin(), sample.end(), [&](std::ptrdiff_t a, std::ptrdiff_t b) {
+                return comp(first[a], first[b]);
+            });
+
+            // Bucket b holds elements x with splitter[b-1] <= x < splitter[b].
+            std::vector<std::ptrdiff_t> splitters((std::size_t)num_buckets - 1);
+            for (std::size_t b = 0; b < splitters.size(); ++b) {
+                splitters[b] = sample[(b + 1) * samplesort_oversampling];
+            }
+            // A bucket between two equal splitters holds the elements equal to them, which are already sorted.
+            std::vector<char> equal_bucket((std::size_t)num_buckets, 0);
+            for (std::size_t b = 1; b < splitters.size(); ++b) {
+                equal_bucket[b] = !comp(first[splitters[b - 1]], first[splitters[b]]);
+            }
+
+            // Classify each element. Each chunk counts its elements per bucket.
+            std::unique_ptr<std::uint8_t[]> bucket_ids(new std::uint8_t[(std::size_t)num_steps]);
+            auto classification = parallel_chunk_for_gen(policy, first, last,
+                [&](RandIt chunk_first, RandIt chunk_last)
+                    -> std::pair<std::pair<RandIt, RandIt>, std::vector<std::ptrdiff_t>> {
+                    std::vector<std::ptrdiff_t> counts((std::size_t)num_buckets, 0);
+                    for (RandIt it = chunk_first; it != chunk_last; ++it) {
+                        std::size_t b = (std::size_t)(std::upper_bound(splitters.begin(), splitters.end(), *it,
+                            [&](const T& x, std::ptrdiff_t splitter) {
+                                return comp(x, first[splitter]);
+                            }) - splitters.begin());
+                        if (b > 0 && equal_bucket[b - 1] && !comp(first[splitters[b - 1]], *it)) {
+                            --b;
+                        }
+                        bucket_ids[(std::size_t)(it - first)] = (std::uint8_t)b;
+                        ++counts[b];
+                    }
+                    return std::make_pair(std::make_pair(chunk_first, chunk_last), std::move(counts));
+                });
+
+            // Turn the counts into each chunk's write position in each bucket.
+            std::vector<std::pair<RandIt, RandIt>> chunks;
+            std::vector<std::vector<std::ptrdiff_t>> positions;
+            for (auto& res : classification) {
+                chunks.push_back(res.first);
+                positions.push_back(std::move(res.second));
+            }
+            std::vector<std::ptrdiff_t> bucket_starts((std::size_t)num_buckets + 1, 0);
+            for (std::size_t b = 0; b < (std::size_t)num_buckets; ++b) {
+                bucket_starts[b + 1] = bucket_starts[b];
+                for (auto& chunk_positions : positions) {
+                    std::ptrdiff_t count = chunk_positions[b];
+                    chunk_positions[b] = bucket_starts[b + 1];
+                    bucket_starts[b + 1] += count;
+                }
+            }
+
+            // Scatter each chunk into the buckets.
+            temp_buffer<T> buffer((std::size_t)num_steps);
+            parallel_for_each_index(task_pool, chunks.size(), [&](std::size_t c) {
+                for (RandIt it = chunks[c].first; it != chunks[c].second; ++it) {
+                    std::ptrdiff_t& pos = positions[c][bucket_ids[(std::size_t)(it - first)]];
+                    ::new (static_cast<void*>(buffer.data() + pos)) T(std::move(*it));
+                    ++pos;
+                }
+            });
+
+            // Move each bucket back and sort it. Largest buckets first, so that they do not finish last.
+            std::vector<std::size_t> bucket_order((std::size_t)num_buckets);
+            std::iota(bucket_order.begin(), bucket_order.end(), (std::size_t)0);
+            std::sort(bucket_order.begin(), bucket_order.end(), [&](std::size_t a, std::size_t b) {
+                return bucket_starts[a + 1] - bucket_starts[a] > bucket_starts[b + 1] - bucket_starts[b];
+            });
+            parallel_for_each_index(task_pool, bucket_order.size(), [&](std::size_t i) {
+                std::size_t b = bucket_order[i];
+                T* buffer_first = buffer.data() + bucket_starts[b];
+                T* buffer_last = buffer.data() + bucket_starts[b + 1];
+                std::move(buffer_first, buffer_last, first + bucket_starts[b]);
+                for (T* p = buffer_first; p != buffer_last; ++p) {
+                    p->~T();
+                }
+                if (!equal_bucket[b]) {
+                    sort_func(first + bucket_starts[b], first + bucket_starts[b + 1], comp);
+                }
+            });
+        }
+
+        /**
+         * Maps a radix sort key to an unsigned integer whose order matches the key's order.
+         */
+        template <class K, class Enable = void>
+        struct radix_key;
+
+        template <class K>
+        struct radix_key<K, typename std::enable_if<std::is_integral<K>::value && std::is_unsigned<K>::value>::type> {
+            using type = K;
+            static type map(K key) { return key; }
+        };
+
+        /**
+         * Signed integers: flip the sign bit so that negative keys come first.
+         */
+        template <class K>
+        struct radix_key<K, typename std::enable_if<std::is_integral<K>::value && std::is_signed<K>::value>::type> {
+            using type = typename std::make_unsigned<K>::type;
+            static type map(K key) {
+                return (type)((type)key ^ ((type)1 << (sizeof(type) * 8 - 1)));
+            }
+        };
+
+        /**
+         * IEEE floats: flip the sign bit of positive keys and every bit of negative keys. -0.0 sorts before 0.0,
+         * and NaNs sort after infinity or, if their sign bit is set, before -infinity.
+         */
+        template <class K>
+        struct radix_key<K, typename std::enable_if<std::is_floating_point<K>::value &&
+                                                    (sizeof(K) == 4 || sizeof(K) == 8)>::type> {
+            using type = typename std::conditional<sizeof(K) == 4, std::uint32_t, std::uint64_t>::type;
+            static type map(K key) {
+                type bits;
+                std::memcpy(&bits, &key, sizeof(key));
+                const type sign = (type)1 << (sizeof(type) * 8 - 1);
+                return (bits & sign) ? (type)~bits : (type)(bits | sign);
+            }
+        };
+
+        /**
+         * Compares elements by their radix sort key. Orders elements the same way as parallel_radix_sort().
+         */
+        template <class KeyFunc>
+        struct radix_key_less {
+            explicit radix_key_less(KeyFunc key): key(key) {}
+
+            template <class T>
+            bool operator()(const T& a, const T& b) const {
+                using K = typename std::decay<decltype(key(a))>::type;
+                return radix_key<K>::map(key(a)) < radix_key<K>::map(key(b));
+            }
+
+            KeyFunc key;
+        };
+
+        /**
+         * Radix sort digit width. Each pass sorts by one digit of this many bits.
+         */
+        constexpr int radix_bits = 8;
+        constexpr std::size_t radix_size = (std::size_t)1 << radix_bits;
+
+        /**
+         * Radix sort chunks have at least this many elements.
+         */
+        constexpr std::ptrdiff_t radix_min_chunk_size = 1024;
+
+        /**
+         * Stable scatter of src[begin, end) to dst by one digit. `positions` holds the next write position for each
+         * digit value and is advanced. If `construct` is set, dst is uninitialized memory.
+         */
+        template <class SrcIt, class DstIt, class KeyMap>
+        void radix_scatter(SrcIt src, DstIt dst, std::ptrdiff_t begin, std::ptrdiff_t end,
+                           std::ptrdiff_t* positions, int shift, KeyMap& key_map, bool construct) {
+            using T = typename std::iterator_traits<DstIt>::value_type;
+            for (std::ptrdiff_t i = begin; i < end; ++i) {
+                std::ptrdiff_t pos = positions[(key_map(src[i]) >> shift) & (radix_size - 1)]++;
+                if (construct) {
+                    ::new (static_cast<void*>(std::addressof(dst[pos]))) T(std::move(src[i]));
+                } else {
+                    dst[pos] = std::move(src[i]);
+                }
+            }
+        }
+
+        /**
+         * Count the values of one digit in src[begin, end).
+         */
+        template <class SrcIt, class KeyMap>
+        void radix_count(SrcIt src, std::ptrdiff_t begin, std::ptrdiff_t end, std::ptrdiff_t* counts, int shift,
+                         KeyMap& key_map) {
+            std::fill(counts, counts + radix_size, 0);
+            for (std::ptrdiff_t i = begin; i < end; ++i) {
+                ++counts[(key_map(src[i]) >> shift) & (radix_size - 1)];
+            }
+        }
+
+        /**
+         * Stable parallel LSD radix sort by `key(element)`, which must be an integer or a float or double.
+         *
+         * The range is split into one fixed chunk per thread. Each pass sorts by one digit: every chunk counts
+         * its digit values in parallel, the counts are summed into each chunk's write position for each value,
+         * and every chunk moves its elements to those positions in parallel. Elements move back and forth
+         * between the range and a scratch buffer. Digits that are equal in every key are skipped.
+         *
+         * Moving elements and `key` must not throw.
+         */
+        template <class ExecPolicy, class RandIt, class KeyFunc>
+        void parallel_radix_sort(ExecPolicy &&policy, RandIt first, RandIt last, KeyFunc key) {
+            using T = typename std::iterator_traits<RandIt>::value_type;
+            using K = typename std::decay<decltype(key(*first))>::type;
+            using U = typename radix_key<K>::type;
+            constexpr int num_digits = (int)(sizeof(U) * 8 + radix_bits - 1) / radix_bits;
+
+            const std::ptrdiff_t num_steps = std::distance(first, last);
+            if (num_steps < 2) {
+                return;
+            }
+            auto& task_pool = *policy.pool();
+
+            auto key_map = [&key](const T& element) -> U { return radix_key<K>::map(key(element)); };
+
+            // Chunks are fixed, so that elements within a chunk keep their order in each pass.
+            const std::ptrdiff_t max_chunks = std::max(std::min((std::ptrdiff_t)task_pool.get_num_threads(),
+                                                                num_steps / radix_min_chunk_size), (std::ptrdiff_t)1);
+            const std::ptrdiff_t chunk_size = (num_steps + max_chunks - 1) / max_chunks;
+            const std::size_t num_chunks = (std::size_t)((num_steps + chunk_size - 1) / chunk_size);
+            auto chunk_begin = [&](std::size_t c) { return std::min((std::ptrdiff_t)c * chunk_size, num_steps); };
+
+            // Count every digit at once to find the digits that need a pass. The counts for the first pass are
+            // reused.
+            std::vector<std::vector<std::ptrdiff_t>> counts(num_chunks,
+                                                            std::vector<std::ptrdiff_t>(num_digits * radix_size, 0));
+            parallel_for_each_index(task_pool, num_chunks, [&](std::size_t c) {
+                std::ptrdiff_t* chunk_counts = counts[c].data();
+                for (std::ptrdiff_t i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+                    U k = key_map(first[i]);
+                    for (int d = 0; d < num_digits; ++d) {
+                        ++chunk_counts[(std::size_t)d * radix_size + ((k >> (d * radix_bits)) & (radix_size - 1))];
+                    }
+                }
+            });
+
+            std::vector<int> digits;
+            for (int d = 0; d < num_digits; ++d) {
+                for (std::size_t v = 0; v < radix_size; ++v) {
+                    std::ptrdiff_t total = 0;
+                    for (auto& chunk_counts : counts) {
+                        total += chunk_counts[(std::size_t)d * radix_size + v];
+                    }
+                    if (total != 0) {
+                        if (total != num_steps) {
+                            digits.push_back(d);
+                        }
+                        break;
+                    }
+                }
+            }
+            if (digits.empty()) {
+                return;
+            }
+
+            temp_buffer<T> buffer((std::size_t)num_steps);
+            T* temp = buffer.data();
+            bool buffer_constructed = false;
+            bool in_buffer = false;
+
+            for (std::size_t pass = 0; pass < digits.size(); ++pass) {
+                const int shift = digits[pass] * radix_bits;
+                std::size_t offset = (std::size_t)digits[pass] * radix_size;
+
+                if (pass > 0) {
+                    offset = 0;
+                    parallel_for_each_index(task_pool, num_chunks, [&](std::size_t c) {
+                        if (in_buffer) {
+                            radix_count(temp, chunk_begin(c), chunk_begin(c + 1), counts[c].data(), shift, key_map);
+                        } else {
+                            radix_count(first, chunk_begin(c), chunk_begin(c + 1), counts[c].data(), shift, key_map);
+                        }
+                    });
+                }
+
+                // Turn the counts into write positions: by digit value, then by chunk.
+                std::ptrdiff_t pos = 0;
+                for (std::size_t v = 0; v < radix_size; ++v) {
+                    for (auto& chunk_counts : counts) {
+                        std::ptrdiff_t count = chunk_counts[offset + v];
+                        chunk_counts[offset + v] = pos;
+                        pos += count;
+                    }
+                }
+
+                const bool construct = !in_buffer && !buffer_constructed;
+                parallel_for_each_index(task_pool, num_chunks, [&](std::size_t c) {
+                    if (in_buffer) {
+                        radix_scatter(temp, first, chunk_begin(c), chunk_begin(c + 1),
+                                      counts[c].data() + offset, shift, key_map, false);
+                    } else {
+                        radix_scatter(first, temp, chunk_begin(c), chunk_begin(c + 1),
+                                      counts[c].data() + offset, shift, key_map, construct);
+                    }
+                });
+                buffer_constructed = true;
+                in_buffer = !in_buffer;
+            }
+
+            parallel_for_each_index(task_pool, num_chunks, [&](std::size_t c) {
+                T* chunk_first = temp + chunk_begin(c);
+                T* chunk_last = temp + chunk_begin(c + 1);
+                if (in_buffer) {
+                    std::move(chunk_first, chunk_last, first + chunk_begin(c));
+                }
+                for (T* p = chunk_first; p != chunk_last; ++p) {
+                    p->~T();
+                }
+            });
+        }
+
+        /**
+         * Number of independent running extrema in lane_scan(). Enough to fill a vector register for most element
+         * types.
+         */
+        constexpr std::ptrdiff_t extremum_lane_count = 16;
+
+        /**
+         * Whether RandIt points to arithmetic values stored contiguously.
+         */
+        template <class RandIt, class T = typename std::iterator_traits<RandIt>::value_type>
+        struct is_contiguous_arithmetic : std::integral_constant<bool,
+            std::is_arithmetic<T>::value && !std::is_same<T, bool>::value &&
+            (std::is_pointer<RandIt>::value ||
+             std::is_same<RandIt, typename std::vector<T>::iterator>::value ||
+             std::is_same<RandIt, typename std::vector<T>::const_iterator>::value)> {};
+
+        /**
+         * Whether min/max_element chunks may use lane_scan(): contiguous arithmetic values compared with
+         * std::less.
+         */
+        template <class RandIt, class Compare>
+        struct use_lane_extremum : std::integral_constant<bool, is_contiguous_arithmetic<RandIt>::value &&
+            std::is_same<Compare, std::less<typename std::iterator_traits<RandIt>::value_type>>::value> {};
+
+        template <class T>
+        bool is_nan_value(const T& v, std::true_type /* floating point */) {
+            return v != v;
+        }
+
+        template <class T>
+        bool is_nan_value(const T&, std::false_type /* floating point */) {
+            return false;
+        }
+
+        /**
+         * The best element of each lane of a lane_scan(). `replaces(a, b)` says whether a later element a replaces
+         * the best element b seen so far.
+         */
+        template <class T, class Replaces>
+        struct extremum_lanes {
+            void init(std::ptrdiff_t lane, const T& v, std::ptrdiff_t i) {
+                best[lane] = v;
+                best_idx[lane] = i;
+            }
+
+            void update(std::ptrdiff_t lane, const T& v, std::ptrdiff_t i) {
+                // selects rather than branches, so the lanes vectorize
+                const bool r = replaces(v, best[lane]);
+                best[lane] = r ? v : best[lane];
+                best_idx[lane] = r ? i : best_idx[lane];
+            }
+
+            /**
+             * Each lane holds the answer for its own subsequence, so comparing the lane winners in index order
+             * gives the same answer as one sequential scan.
+             */
+            std::ptrdiff_t result(const T* data) {
+                std::sort(best_idx, best_idx + extremum_lane_count);
+                std::ptrdiff_t ret = best_idx[0];
+                for (std::ptrdiff_t lane = 1; lane < extremum_lane_count; ++lane) {
+                    if (replaces(data[best_idx[lane]], data[ret])) {
+                        ret = best_idx[lane];
+                    }
+                }
+                return ret;
+            }
+
+            Replaces replaces;
+            T best[extremum_lane_count];
+            std::ptrdiff_t best_idx[extremum_lane_count];
+        };
+
+        /**
+         * Two extremum_lanes updated in the same scan, for minmax_element.
+         */
+        template <class T, class Lanes1, class Lanes2>
+        struct extremum_lanes_pair {
+            void init(std::ptrdiff_t lane, const T& v, std::ptrdiff_t i) {
+                first.init(lane, v, i);
+                second.init(lane, v, i);
+            }
+
+            void update(std::ptrdiff_t lane, const T& v, std::ptrdiff_t i) {
+                first.update(lane, v, i);
+                second.update(lane, v, i);
+            }
+
+            Lanes1 first;
+            Lanes2 second;
+        };
+
+        /**
+         * Scan data[0, n) with extremum_lane_count interleaved lanes: element i goes to lane i % extremum_lane_count.
+         * The lanes are independent so the compiler can vectorize the scan. Requires n >= extremum_lane_count.
+         *
+         * @return false if data contains a NaN. Lanes do not reproduce a sequential scan's handling of NaNs, so the
+         *         caller must fall back to one.
+         */
+        template <class T, class Lanes>
+        bool lane_scan(const T* data, std::ptrdiff_t n, Lanes& lanes) {
+            const std::integral_constant<bool, std::is_floating_point<T>::value> is_fp;
+            bool has_nan = false;
+            for (std::ptrdiff_t lane = 0; lane < extremum_lane_count; ++lane) {
+                lanes.init(lane, data[lane], lane);
+                has_nan |= is_nan_value(data[lane], is_fp);
+            }
+            std::ptrdiff_t i = extremum_lane_count;
+            for (; i + extremum_lane_count <= n; i += extremum_lane_count) {
+                for (std::ptrdiff_t lane = 0; lane < extremum_lane_count; ++lane) {
+                    const T v = data[i + lane];
+                    lanes.update(lane, v, i + lane);
+                    has_nan |= is_nan_value(v, is_fp);
+                }
+            }
+            for (std::ptrdiff_t lane = 0; lane < n - i; ++lane) {
+                lanes.update(lane, data[i + lane], i + lane);
+                has_nan |= is_nan_value(data[i + lane], is_fp);
+            }
+            return !has_nan;
+        }
+
+        template <class RandIt, class Compare>
+        RandIt min_element_chunk(RandIt first, RandIt last, Compare comp, std::false_type /* use lanes */) {
+            return std::min_element(first, last, comp);
+        }
+
+        template <class RandIt, class Compare>
+        RandIt min_element_chunk(RandIt first, RandIt last, Compare comp, std::true_type /* use lanes */) {
+            using T = typename std::iterator_traits<RandIt>::value_type;
+            extremum_lanes<T, std::less<T>> lanes;
+            if (last - first < extremum_lane_count || !lane_scan(&*first, last - first, lanes)) {
+                return std::min_element(first, last, comp);
+            }
+            return first + lanes.result(&*first);
+        }
+
+        template <class RandIt, class Compare>
+        RandIt max_element_chunk(RandIt first, RandIt last, Compare comp, std::false_type /* use lanes */) {
+            return std::max_element(first, last, comp);
+        }
+
+        template <class RandIt, class Compare>
+        RandIt max_element_chunk(RandIt first, RandIt last, Compare comp, std::true_type /* use lanes */) {
+            using T = typename std::iterator_traits<RandIt>::value_type;
+            extremum_lanes<T, std::greater<T>> lanes;
+            if (last - first < extremum_lane_count || !lane_scan(&*first, last - first, lanes)) {
+                return std::max_element(first, last, comp);
+            }
+            return first + lanes.result(&*first);
+        }
+
+        template <class RandIt, class Compare>
+        std::pair<RandIt, RandIt> minmax_element_chunk(RandIt first, RandIt last, Compare comp,
+                                                       std::false_type /* use lanes */) {
+            return std::minmax_element(first, last, comp);
+        }
+
+        template <class RandIt, class Compare>
+        std::pair<RandIt, RandIt> minmax_element_chunk(RandIt first, RandIt last, Compare comp,
+                                                       std::true_type /* use lanes */) {
+            using T = typename std::iterator_traits<RandIt>::value_type;
+            // minmax_element returns the last largest element, so equal elements replace the maximum
+            extremum_lanes_pair<T, extremum_lanes<T, std::less<T>>, extremum_lanes<T, std::greater_equal<T>>> lanes;
+            if (last - first < extremum_lane_count || !lane_scan(&*first, last - first, lanes)) {
+                return std::minmax_element(first, last, comp);
+            }
+            return std::make_pair(first + lanes.first.result(&*first), first + lanes.second.result(&*first));
+        }
+
+        /**
+         * Parallel std::min_element. Ties resolve to the first occurrence.
+         */
+        template <class ExecPolicy, class RandIt, class Compare>
+        RandIt parallel_min_element(ExecPolicy &&policy, RandIt first, RandIt last, Compare comp) {
+            if (first == last) {
+                return last;
+            }
+            auto results = parallel_chunk_for_gen(std::forward<ExecPolicy>(policy), first, last,
+                [comp](RandIt chunk_first, RandIt chunk_last) {
+                    return min_element_chunk(chunk_first, chunk_last, comp, use_lane_extremum<RandIt, Compare>());
+                });
+
+            RandIt ret = last;
+            for (RandIt candidate : results) {
+                if (ret == last || comp(*candidate, *ret)) {
+                    ret = candidate;
+                }
+            }
+            return ret;
+        }
+
+        /**
+         * Parallel std::max_element. Ties resolve to the first occurrence.
+         */
+        template <class ExecPolicy, class RandIt, class Compare>
+        RandIt parallel_max_element(ExecPolicy &&policy, RandIt first, RandIt last, Compare comp) {
+            if (first == last) {
+                return last;
+            }
+            auto results = parallel_chunk_for_gen(std::forward<ExecPolicy>(policy), first, last,
+                [comp](RandIt chunk_first, RandIt chunk_last) {
+                    return max_element_chunk(chunk_first, chunk_last, comp, use_lane_extremum<RandIt, Compare>());
+                });
+
+            RandIt ret = last;
+            for (RandIt candidate : results) {
+                if (ret == last || comp(*ret, *candidate)) {
+                    ret = candidate;
+                }
+            }
+            return ret;
+        }
+
+        /**
+         * Parallel std::minmax_element. Like the sequential version, returns the first smallest and the last
+         * largest element.
+         */
+        template <class ExecPolicy, class RandIt, class Compare>
+        std::pair<RandIt, RandIt> parallel_minmax_element(ExecPolicy &&policy, RandIt first, RandIt last,
+                                                          Compare comp) {
+            if (first == last) {
+                return std::make_pair(last, last);
+            }
+            auto results = parallel_chunk_for_gen(std::forward<ExecPolicy>(policy), first, last,
+                [comp](RandIt chunk_first, RandIt chunk_last) {
+                    return minmax_element_chunk(chunk_first, chunk_last, comp, use_lane_extremum<RandIt, Compare>());
+                });
+
+            std::pair<RandIt, RandIt> ret(last, last);
+            for (const std::pair<RandIt, RandIt>& candidate : results) {
+                if (ret.first == last || comp(*candidate.first, *ret.first)) {
+                    ret.first = candidate.first;
+                }
+                if (ret.second == last || !comp(*candidate.second, *ret.second)) {
+                    ret.second = candidate.second;
+                }
+            }
+            return ret;
+        }
+
+        /**
+         * Find the first match in [first, last) in parallel. Uses the same design as find_if(par): small chunks, so
+         * that chunks after an already found match can skip their work, and a priority update of the earliest match.
+         *
+         * @param chunk_find Called as `chunk_find(chunk_first, chunk_last)`. Returns the first match in the chunk,
+         *                   or chunk_last if there is none.
+         * @return The first match, or last if there is none.
+         */
+        template <class ExecPolicy, class RandIt, class ChunkFind>
+        RandIt parallel_find_first(ExecPolicy &&policy, RandIt first, RandIt last, ChunkFind chunk_find) {
+            using diff_t = typename std::iterator_traits<RandIt>::difference_type;
+            const diff_t n = std::distance(first, last);
+            std::atomic<diff_t> extremum(n);
+
+            parallel_chunk_for_1(std::forward<ExecPolicy>(policy), first, last,
+                [first, &extremum, &chunk_find](RandIt chunk_first, RandIt chunk_last) {
+                    if (std::distance(first, chunk_first) > extremum) {
+                        // already found by another task
+                        return;
+                    }
+
+                    RandIt chunk_res = chunk_find(chunk_first, chunk_last);
+                    if (chunk_res != chunk_last) {
+                        const diff_t k = std::distance(first, chunk_res);
+                        for (diff_t old = extremum; k < old; old = extremum) {
+                            extremum.compare_exchange_weak(old, k);
+                        }
+                    }
+                }, (void*)nullptr, 8);
+            return extremum == n ? last : first + extremum;
+        }
+
+        /**
+         * Parallel std::mismatch over [first1, last1) and the range of the same length starting at first2.
+         */
+        template <class ExecPolicy, class RandIt1, class RandIt2, class BinaryPredicate>
+        std::pair<RandIt1, RandIt2> parallel_mismatch(ExecPolicy &&policy, RandIt1 first1, RandIt1 last1,
+                                                      RandIt2 first2, BinaryPredicate pred) {
+            RandIt1 ret = parallel_find_first(std::forward<ExecPolicy>(policy), first1, last1,
+                [first1, first2, pred](RandIt1 chunk_first, RandIt1 chunk_last) {
+                    return std::mismatch(chunk_first, chunk_last, first2 + (chunk_first - first1), pred).first;
+                });
+            return std::make_pair(ret, first2 + (ret - first1));
+        }
+
+        /**
+         * Parallel std::adjacent_find. Each chunk also checks the pair that starts at its last element, so pairs
+         * that straddle a chunk boundary are checked too.
+         */
+        template <class ExecPolicy, class RandIt, class BinaryPredicate>
+        RandIt parallel_adjacent_find(ExecPolicy &&policy, RandIt first, RandIt last, BinaryPredicate pred) {
+            if (std::distance(first, last) < 2) {
+                return last;
+            }
+            // search the positions of the first element of each pair
+            RandIt pairs_last = last - 1;
+            RandIt ret = parallel_find_first(std::forward<ExecPolicy>(policy), first, pairs_last,
+                [pred](RandIt chunk_first, RandIt chunk_last) {
+                    RandIt found = std::adjacent_find(chunk_first, chunk_last + 1, pred);
+                    return found == chunk_last + 1 ? chunk_last : found;
+                });
+            return ret == pairs_last ? last : ret;
+        }
+
+        /**
+         * Parallel std::is_sorted_until.
+         */
+        template <class ExecPolicy, class RandIt, class Compare>
+        RandIt parallel_is_sorted_until(ExecPolicy &&policy, RandIt first, RandIt last, Compare comp) {
+            using T = typename std::iterator_traits<RandIt>::value_type;
+            RandIt ret = parallel_adjacent_find(std::forward<ExecPolicy>(policy), first, last,
+                                                [comp](const T& a, const T& b) mutable { return comp(b, a); });
+            return ret == last ? last : ret + 1;
+        }
+
+        /**
+         * Parallel std::lexicographical_compare. Finds the first position where neither element is less than the
+         * other, which decides the comparison.
+         */
+        template <class ExecPolicy, class RandIt1, class RandIt2, class Compare>
+        bool parallel_lexicographical_compare(ExecPolicy &&policy, RandIt1 first1, RandIt1 last1,
+                                              RandIt2 first2, RandIt2 last2, Compare comp) {
+            using T1 = typename std::iterator_traits<RandIt1>::value_type;
+            using T2 = typename std::iterator_traits<RandIt2>::value_type;
+            const auto size1 = std::distance(first1, last1);
+            const auto size2 = std::distance(first2, last2);
+            const RandIt1 common_last1 = first1 + std::min<std::ptrdiff_t>(size1, size2);
+
+            auto diff = parallel_mismatch(std::forward<ExecPolicy>(policy), first1, common_last1, first2,
+                [comp](const T1& a, const T2& b) mutable { return !comp(a, b) && !comp(b, a); });
+            if (diff.first == common_last1) {
+                return size1 < size2;
+            }
+            return comp(*diff.first, *diff.second);
+        }
+
+        /**
+         * Parallel std::search. Searches the possible match start positions. A chunk reads up to pattern length minus
+         * one elements past its end, so it finds every match that starts in the chunk.
+         */
+        template <class ExecPolicy, class RandIt1, class RandIt2, class BinaryPredicate>
+        RandIt1 parallel_search(ExecPolicy &&policy, RandIt1 first, RandIt1 last, RandIt2 s_first, RandIt2 s_last,
+                                BinaryPredicate pred) {
+            const std::ptrdiff_t pattern_size = std::distance(s_first, s_last);
+            if (pattern_size == 0) {
+                return first;
+            }
+            if (std::distance(first, last) < pattern_size) {
+                return last;
+            }
+
+            RandIt1 starts_last = last - (pattern_size - 1);
+            RandIt1 ret = parallel_find_first(std::forward<ExecPolicy>(policy), first, starts_last,
+                [s_first, s_last, pattern_size, pred](RandIt1 chunk_first, RandIt1 chunk_last) {
+                    RandIt1 window_last = chunk_last + (pattern_size - 1);
+                    RandIt1 found = std::search(chunk_first, window_last, s_first, s_last, pred);
+                    return found == window_last ? chunk_last : found;
+                });
+            return ret == starts_last ? last : ret;
+        }
+
+        /**
+         * Parallel std::search_n. Like parallel_search(), chunks overlap by count minus one elements.
+         */
+        template <class ExecPolicy, class RandIt, class Size, class T, class BinaryPredicate>
+        RandIt parallel_search_n(ExecPolicy &&policy, RandIt first, RandIt last, Size count, const T& value,
+                                 BinaryPredicate pred) {
+            if (count <= 0) {
+                return first;
+            }
+            const std::ptrdiff_t run_size = (std::ptrdiff_t)count;
+            if (std::distance(first, last) < run_size) {
+                return last;
+            }
+
+            RandIt starts_last = last - (run_size - 1);
+            RandIt ret = parallel_find_first(std::forward<ExecPolicy>(policy), first, starts_last,
+                [count, run_size, &value, pred](RandIt chunk_first, RandIt chunk_last) {
+                    RandIt window_last = chunk_last + (run_size - 1);
+                    RandIt found = std::search_n(chunk_first, window_last, count, value, pred);
+                    return found == window_last ? chunk_last : found;
+                });
+            return ret == starts_last ? last : ret;
+        }
+
+        /**
+         * Parallel std::find_end. The last match is the first match of the reversed pattern in the reversed range.
+         */
+        template <class ExecPolicy, class RandIt1, class RandIt2, class BinaryPredicate>
+        RandIt1 parallel_find_end(ExecPolicy &&policy, RandIt1 first, RandIt1 last, RandIt2 s_first, RandIt2 s_last,
+                                  BinaryPredicate pred) {
+            const std::ptrdiff_t pattern_size = std::distance(s_first, s_last);
+            if (pattern_size == 0) {
+                return last;
+            }
+
+            std::reverse_iterator<RandIt1> rlast(first);
+            std::reverse_iterator<RandIt1> ret = parallel_search(std::forward<ExecPolicy>(policy),
+                                                                 std::reverse_iterator<RandIt1>(last), rlast,
+                                                                 std::reverse_iterator<RandIt2>(s_last),
+                                                                 std::reverse_iterator<RandIt2>(s_first), pred);
+            return ret == rlast ? last : ret.base() - pattern_size;
+        }
+
+        /**
+         * Parallel std::find_first_of.
+         */
+        template <class ExecPolicy, class RandIt1, class RandIt2, class BinaryPredicate>
+        RandIt1 parallel_find_first_of(ExecPolicy &&policy, RandIt1 first, RandIt1 last,
+                                       RandIt2 s_first, RandIt2 s_last, BinaryPredicate pred) {
+            return parallel_find_first(std::forward<ExecPolicy>(policy), first, last,
+                [s_first, s_last, pred](RandIt1 chunk_first, RandIt1 chunk_last) {
+                    return std::find_first_of(chunk_first, chunk_last, s_first, s_last, pred);
+                });
         }
     }
 }
@@ -38,6 +38,12 @@
 namespace poolstl {
     namespace internal {
 
+        /**
+         * Special extra_split_factor for chunk functions with a per-chunk setup cost, such as for_each_chunk's
+         * `construct`. Splits into at most one chunk per thread and does not probe the per-element cost.
+         */
+        constexpr int one_chunk_per_thread = 0;
+
         inline constexpr std::size_t get_chunk_size(std::size_t num_steps, unsigned int num_threads) {
             return (num_steps / num_threads) + ((num_steps % num_threads) > 0 ? 1 : 0);
         }
@@ -101,6 +107,31 @@ namespace poolstl {
             }
         }
 
+        /**
+         * Unary op that passes elements through unchanged. Like C++20's std::identity.
+         */
+        struct identity {
+            template <class T>
+            const T& operator()(const T& x) const { return x; }
+        };
+
+        /**
+         * Binary predicate that compares with operator==, which may take different types. Like C++14's
+         * std::equal_to<>.
+         */
+        struct equal_to {
+            template <class T, class U>
+            bool operator()(const T& a, const U& b) const { return a == b; }
+        };
+
+        /**
+         * Comparator that compares with operator<, which may take different types. Like C++14's std::less<>.
+         */
+        struct less {
+            template <class T, class U>
+            bool operator()(const T& a, const U& b) const { return a < b; }
+        };
+
         /**
          * Identify a pivot element for quicksort. Chooses the middle element of the range.
          */
@@ -75,6 +75,7 @@ namespace poolstl {
 namespace std {
     // <algorithm>
 
+    POOLSTL_DEFINE_SEQ_FWD(std, adjacent_find)
     POOLSTL_DEFINE_SEQ_FWD(std, all_of)
     POOLSTL_DEFINE_SEQ_FWD(std, any_of)
     POOLSTL_DEFINE_SEQ_FWD(std, none_of)
@@ -84,11 +85,17 @@ namespace std {
 
     POOLSTL_DEFINE_SEQ_FWD(std, copy)
     POOLSTL_DEFINE_SEQ_FWD(std, copy_n)
+    POOLSTL_DEFINE_SEQ_FWD(std, copy_if)
+
+    POOLSTL_DEFINE_SEQ_FWD(std, equal)
+    POOLSTL_DEFINE_SEQ_FWD(std, mismatch)
 
     POOLSTL_DEFINE_SEQ_FWD_VOID(std, fill)
     POOLSTL_DEFINE_SEQ_FWD(std, fill_n)
 
     POOLSTL_DEFINE_SEQ_FWD(std, find)
+    POOLSTL_DEFINE_SEQ_FWD(std, find_end)
+    POOLSTL_DEFINE_SEQ_FWD(std, find_first_of)
     POOLSTL_DEFINE_SEQ_FWD(std, find_if)
     POOLSTL_DEFINE_SEQ_FWD(std, find_if_not)
 
@@ -97,15 +104,47 @@ namespace std {
     POOLSTL_DEFINE_SEQ_FWD(std, for_each_n)
 #endif
 
+    POOLSTL_DEFINE_SEQ_FWD(std, includes)
+    POOLSTL_DEFINE_SEQ_FWD_VOID(std, inplace_merge)
+    POOLSTL_DEFINE_SEQ_FWD(std, merge)
+
+    POOLSTL_DEFINE_SEQ_FWD(std, is_partitioned)
+    POOLSTL_DEFINE_SEQ_FWD(std, is_sorted)
+    POOLSTL_DEFINE_SEQ_FWD(std, is_sorted_until)
+    POOLSTL_DEFINE_SEQ_FWD(std, lexicographical_compare)
+
+    POOLSTL_DEFINE_SEQ_FWD(std, max_element)
+    POOLSTL_DEFINE_SEQ_FWD(std, min_element)
+    POOLSTL_DEFINE_SEQ_FWD(std, minmax_element)
+
+    POOLSTL_DEFINE_SEQ_FWD_VOID(std, nth_element)
+    POOLSTL_DEFINE_SEQ_FWD_VOID(std, partial_sort)
+    POOLSTL_DEFINE_SEQ_FWD(std, partial_sort_copy)
+
     POOLSTL_DEFINE_SEQ_FWD(std, partition)
+    POOLSTL_DEFINE_SEQ_FWD(std, partition_copy)
+    POOLSTL_DEFINE_SEQ_FWD(std, stable_partition)
+    POOLSTL_DEFINE_SEQ_FWD(std, remove)
+    POOLSTL_DEFINE_SEQ_FWD(std, remove_if)
+    POOLSTL_DEFINE_SEQ_FWD(std, search)
+    POOLSTL_DEFINE_SEQ_FWD(std, search_n)
+    POOLSTL_DEFINE_SEQ_FWD(std, set_difference)
+    POOLSTL_DEFINE_SEQ_FWD(std, set_intersection)
+    POOLSTL_DEFINE_SEQ_FWD(std, set_symmetric_difference)
+    POOLSTL_DEFINE_SEQ_FWD(std, set_union)
     POOLSTL_DEFINE_SEQ_FWD(std, transform)
     POOLSTL_DEFINE_SEQ_FWD(std, sort)
+    POOLSTL_DEFINE_SEQ_FWD(std, unique)
+    POOLSTL_DEFINE_SEQ_FWD(std, unique_copy)
 
     // <numeric>
 
 #if POOLSTL_SEQ_FWD_HAVE_CXX17_LIB
     POOLSTL_DEFINE_SEQ_FWD(std, exclusive_scan)
+    POOLSTL_DEFINE_SEQ_FWD(std, inclusive_scan)
     POOLSTL_DEFINE_SEQ_FWD(std, reduce)
+    POOLSTL_DEFINE_SEQ_FWD(std, transform_exclusive_scan)
+    POOLSTL_DEFINE_SEQ_FWD(std, transform_inclusive_scan)
     POOLSTL_DEFINE_SEQ_FWD(std, transform_reduce)
 #endif
 }
@@ -5,7 +5,15 @@
 
 
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 #include <catch2/catch_test_macros.hpp>
 
@@ -31,6 +39,44 @@ namespace Catch {
 }
 
 
+/**
+ * Positions to place a defect at in a range of num_iters elements. Every position for small ranges, so that chunk
+ * boundaries are covered.
+ */
+static std::vector<int> defect_positions(int num_iters) {
+    if (num_iters <= 1000) {
+        return iota_vector(num_iters);
+    }
+    return {0, 1, num_iters / 3, num_iters / 2, num_iters - 2, num_iters - 1};
+}
+
+constexpr std::array<int, 9> defect_arr_sizes = {0, 1, 2, 3, 10, 101, 1000, 10000, 100003};
+
+TEST_CASE("adjacent_find", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (int num_iters : defect_arr_sizes) {
+            auto source = iota_vector(num_iters);
+            REQUIRE(std::adjacent_find(poolstl::par.on(pool), source.cbegin(), source.cend()) == source.cend());
+
+            for (int pos : defect_positions(std::max(num_iters - 1, 0))) {
+                auto work = source;
+                work[pos + 1] = work[pos];
+                REQUIRE(std::adjacent_find(poolstl::par.on(pool), work.cbegin(), work.cend()) ==
+                        std::adjacent_find(work.cbegin(), work.cend()));
+                REQUIRE(std::adjacent_find(poolstl::par_if(false), work.cbegin(), work.cend()) ==
+                        std::adjacent_find(work.cbegin(), work.cend()));
+
+                // first descent
+                work[pos + 1] = -1;
+                REQUIRE(std::adjacent_find(poolstl::par.on(pool), work.cbegin(), work.cend(), std::greater<int>()) ==
+                        std::adjacent_find(work.cbegin(), work.cend(), std::greater<int>()));
+            }
+        }
+    }
+}
+
 TEST_CASE("any_all_none", "[alg][algorithm]") {
     for (auto num_threads : test_thread_counts) {
         ttp::task_thread_pool pool(num_threads);
@@ -106,6 +152,38 @@ TEST_CASE("copy_n", "[alg][algorithm]") {
     }
 }
 
+TEST_CASE("copy_if", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (int num_iters : {0, 1, 2, 3, 10, 101, 10000, 100003}) {
+            auto source = iota_vector(num_iters);
+            scramble(source);
+
+            for (int modulus : {1, 2, 7, num_iters + 1}) {
+                auto pred = [modulus] (const int& em) { return em % modulus == 0; };
+
+                std::vector<int> expected(source.size());
+                auto expected_end = std::copy_if(source.cbegin(), source.cend(), expected.begin(), pred);
+                {
+                    std::vector<int> dest(source.size(), -1);
+                    auto end = std::copy_if(poolstl::par_if(false), source.cbegin(), source.cend(), dest.begin(), pred);
+                    REQUIRE(std::distance(dest.begin(), end) == std::distance(expected.begin(), expected_end));
+                    REQUIRE(std::equal(dest.begin(), end, expected.begin()));
+                }
+                {
+                    std::vector<int> dest(source.size(), -1);
+                    auto end = std::copy_if(poolstl::par.on(pool), source.cbegin(), source.cend(), dest.begin(), pred);
+                    REQUIRE(std::distance(dest.begin(), end) == std::distance(expected.begin(), expected_end));
+                    REQUIRE(std::equal(dest.begin(), end, expected.begin()));
+                    // nothing written past the end
+                    REQUIRE(std::all_of(end, dest.end(), [](int v) { return v == -1; }));
+                }
+            }
+        }
+    }
+}
+
 TEST_CASE("count", "[alg][algorithm]") {
     for (auto num_threads : test_thread_counts) {
         ttp::task_thread_pool pool(num_threads);
@@ -129,6 +207,49 @@ TEST_CASE("count", "[alg][algorithm]") {
     }
 }
 
+TEST_CASE("equal_mismatch", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (int num_iters : defect_arr_sizes) {
+            auto source = iota_vector(num_iters);
+            REQUIRE(std::equal(poolstl::par.on(pool), source.cbegin(), source.cend(), source.cbegin()));
+            REQUIRE(std::mismatch(poolstl::par.on(pool), source.cbegin(), source.cend(), source.cbegin()).first ==
+                    source.cend());
+
+            std::vector<int> positions = defect_positions(num_iters);
+            positions.push_back(-1); // no defect
+            for (int pos : positions) {
+                auto work = source;
+                if (pos >= 0) {
+                    work[pos] = -1;
+                }
+                auto expected = std::mismatch(source.cbegin(), source.cend(), work.cbegin());
+
+                REQUIRE(std::mismatch(poolstl::par.on(pool), source.cbegin(), source.cend(), work.cbegin()) ==
+                        expected);
+                REQUIRE(std::mismatch(poolstl::par_if(false), source.cbegin(), source.cend(), work.cbegin()) ==
+                        expected);
+                REQUIRE(std::mismatch(poolstl::par.on(pool), source.cbegin(), source.cend(), work.cbegin(),
+                                      [](int a, int b) { return a == b; }) == expected);
+                REQUIRE(std::equal(poolstl::par.on(pool), source.cbegin(), source.cend(), work.cbegin()) ==
+                        (pos < 0));
+                REQUIRE(std::equal(poolstl::par_if(false), source.cbegin(), source.cend(), work.cbegin()) ==
+                        (pos < 0));
+
+                // second range shorter
+                auto half_last = work.cbegin() + num_iters / 2;
+                REQUIRE(std::mismatch(poolstl::par.on(pool), source.cbegin(), source.cend(), work.cbegin(),
+                                      half_last) ==
+                        std::mismatch(source.cbegin(), source.cend(), work.cbegin(), half_last));
+                REQUIRE(std::equal(poolstl::par.on(pool), source.cbegin(), source.cend(), work.cbegin(),
+                                   half_last) ==
+                        std::equal(source.cbegin(), source.cend(), work.cbegin(), half_last));
+            }
+        }
+    }
+}
+
 TEST_CASE("fill", "[alg][algorithm]") {
     for (auto num_threads : test_thread_counts) {
         ttp::task_thread_pool pool(num_threads);
@@ -321,6 +442,378 @@ TEST_CASE("inplace_merge", "[alg][algorithm]") {
     }
 }
 
+TEST_CASE("temp_buffer", "[alg]") {
+    // buffers created one after another on a thread reuse the same memory
+    int* first;
+    {
+        poolstl::internal::temp_buffer<int> buffer(1000);
+        first = buffer.data();
+    }
+    {
+        poolstl::internal::temp_buffer<int> buffer(500);
+        REQUIRE(buffer.data() == first);
+
+        // a buffer created while the cached one is in use gets its own memory
+        poolstl::internal::temp_buffer<int> nested(500);
+        REQUIRE(nested.data() != first);
+    }
+}
+
+TEST_CASE("is_partitioned", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (int num_iters : defect_arr_sizes) {
+            auto source = iota_vector(num_iters);
+
+            for (int pivot : {0, num_iters / 3, num_iters}) {
+                auto pred = [pivot](int x) { return x < pivot; };
+                REQUIRE(std::is_partitioned(poolstl::par.on(pool), source.cbegin(), source.cend(), pred));
+                REQUIRE(std::is_partitioned(poolstl::par_if(false), source.cbegin(), source.cend(), pred));
+
+                for (int pos : defect_positions(num_iters)) {
+                    auto work = source;
+                    work[pos] = pos < pivot ? num_iters : -1;
+                    REQUIRE(std::is_partitioned(poolstl::par.on(pool), work.cbegin(), work.cend(), pred) ==
+                            std::is_partitioned(work.cbegin(), work.cend(), pred));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("is_sorted", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (int num_iters : defect_arr_sizes) {
+            auto source = iota_vector(num_iters);
+            REQUIRE(std::is_sorted(poolstl::par.on(pool), source.cbegin(), source.cend()));
+            REQUIRE(std::is_sorted_until(poolstl::par.on(pool), source.cbegin(), source.cend()) == source.cend());
+
+            for (int pos : defect_positions(num_iters)) {
+                auto work = source;
+                work[pos] = pos == 0 ? num_iters : -1;
+                auto expected = std::is_sorted_until(work.cbegin(), work.cend());
+
+                REQUIRE(std::is_sorted_until(poolstl::par.on(pool), work.cbegin(), work.cend()) == expected);
+                REQUIRE(std::is_sorted_until(poolstl::par_if(false), work.cbegin(), work.cend()) == expected);
+                REQUIRE(std::is_sorted(poolstl::par.on(pool), work.cbegin(), work.cend()) ==
+                        std::is_sorted(work.cbegin(), work.cend()));
+                REQUIRE(std::is_sorted(poolstl::par.on(pool), work.crbegin(), work.crend(), std::greater<int>()) ==
+                        std::is_sorted(work.crbegin(), work.crend(), std::greater<int>()));
+            }
+        }
+    }
+}
+
+TEST_CASE("lexicographical_compare", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (int num_iters : defect_arr_sizes) {
+            auto source = iota_vector(num_iters);
+
+            std::vector<int> positions = defect_positions(num_iters);
+            positions.push_back(-1); // no defect
+            for (int pos : positions) {
+                for (int delta : {-1, 1}) {
+                    auto work = source;
+                    if (pos >= 0) {
+                        work[pos] += delta;
+                    }
+                    for (std::size_t work_size : {work.size(), work.size() / 2, work.size() + 1}) {
+                        work.resize(work_size, 0);
+                        REQUIRE(std::lexicographical_compare(poolstl::par.on(pool), source.cbegin(), source.cend(),
+                                                             work.cbegin(), work.cend()) ==
+                                std::lexicographical_compare(source.cbegin(), source.cend(),
+                                                             work.cbegin(), work.cend()));
+                        REQUIRE(std::lexicographical_compare(poolstl::par.on(pool), work.cbegin(), work.cend(),
+                                                             source.cbegin(), source.cend()) ==
+                                std::lexicographical_compare(work.cbegin(), work.cend(),
+                                                             source.cbegin(), source.cend()));
+                        REQUIRE(std::lexicographical_compare(poolstl::par_if(false), work.cbegin(), work.cend(),
+                                                             source.cbegin(), source.cend(), std::greater<int>()) ==
+                                std::lexicographical_compare(work.cbegin(), work.cend(),
+                                                             source.cbegin(), source.cend(), std::greater<int>()));
+                        REQUIRE(std::lexicographical_compare(poolstl::par.on(pool), work.cbegin(), work.cend(),
+                                                             source.cbegin(), source.cend(), std::greater<int>()) ==
+                                std::lexicographical_compare(work.cbegin(), work.cend(),
+                                                             source.cbegin(), source.cend(), std::greater<int>()));
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("merge", "[alg][algorithm]") {
+    // equal elements must keep their order, with the first range's first
+    auto order = [](const std::vector<stable_sort_element>& v) {
+        std::vector<int> ret;
+        for (auto& e : v) {
+            ret.push_back(e.nc);
+        }
+        return ret;
+    };
+
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        std::vector<int> sizes(test_arr_sizes.begin(), test_arr_sizes.end());
+        sizes.push_back(30000);
+        for (auto num_iters : sizes) {
+            auto source = iota_vector<stable_sort_element>(num_iters);
+            for (auto& e : source) {
+                e.compared /= 3;
+            }
+            scramble(source);
+
+            for (std::size_t mid : {(std::size_t)0, source.size() / 3, source.size() / 2, source.size()}) {
+                std::vector<stable_sort_element> work(source);
+                std::sort(work.begin(), work.begin() + (std::ptrdiff_t)mid);
+                std::sort(work.begin() + (std::ptrdiff_t)mid, work.end());
+
+                std::vector<stable_sort_element> dest1(work.size());
+                std::merge(work.begin(), work.begin() + (std::ptrdiff_t)mid, work.begin() + (std::ptrdiff_t)mid,
+                           work.end(), dest1.begin());
+                {
+                    std::vector<stable_sort_element> dest(work.size());
+                    auto ret = std::merge(poolstl::par.on(pool), work.begin(), work.begin() + (std::ptrdiff_t)mid,
+                                          work.begin() + (std::ptrdiff_t)mid, work.end(), dest.begin());
+                    REQUIRE(ret == dest.end());
+                    REQUIRE(dest == dest1);
+                    REQUIRE(order(dest) == order(dest1));
+                }
+                {
+                    std::vector<stable_sort_element> dest(work.size());
+                    std::merge(poolstl::par_if(false), work.begin(), work.begin() + (std::ptrdiff_t)mid,
+                               work.begin() + (std::ptrdiff_t)mid, work.end(), dest.begin());
+                    REQUIRE(order(dest) == order(dest1));
+                }
+                {
+                    std::vector<stable_sort_element> inplace(work);
+                    std::inplace_merge(poolstl::par.on(pool), inplace.begin(),
+                                       inplace.begin() + (std::ptrdiff_t)mid, inplace.end());
+                    REQUIRE(order(inplace) == order(dest1));
+                }
+                {
+                    // elements with non-trivial moves
+                    std::vector<std::string> strs;
+                    for (auto& e : work) {
+                        strs.push_back(std::to_string(e.compared));
+                    }
+                    auto str_less = [](const std::string& a, const std::string& b) {
+                        return std::stoi(a) < std::stoi(b);
+                    };
+                    std::vector<std::string> sdest(strs);
+                    std::inplace_merge(sdest.begin(), sdest.begin() + (std::ptrdiff_t)mid, sdest.end(), str_less);
+                    std::inplace_merge(poolstl::par.on(pool), strs.begin(), strs.begin() + (std::ptrdiff_t)mid,
+                                       strs.end(), str_less);
+                    REQUIRE(sdest == strs);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("min_max_element", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (int num_iters : {0, 1, 2, 3, 10, 17, 101, 10000, 100003}) {
+            // few distinct values, so there are many ties
+            for (int num_distinct : {1, 3, 1000}) {
+                std::vector<int> source(num_iters);
+                for (int i = 0; i < num_iters; ++i) {
+                    source[i] = (int)((i * 7919LL) % num_distinct);
+                }
+
+                REQUIRE(std::min_element(poolstl::par.on(pool), source.cbegin(), source.cend()) ==
+                        std::min_element(source.cbegin(), source.cend()));
+                REQUIRE(std::max_element(poolstl::par.on(pool), source.cbegin(), source.cend()) ==
+                        std::max_element(source.cbegin(), source.cend()));
+                REQUIRE(std::minmax_element(poolstl::par.on(pool), source.cbegin(), source.cend()) ==
+                        std::minmax_element(source.cbegin(), source.cend()));
+
+                REQUIRE(std::min_element(poolstl::par_if(false), source.cbegin(), source.cend()) ==
+                        std::min_element(source.cbegin(), source.cend()));
+                REQUIRE(std::max_element(poolstl::par_if(false), source.cbegin(), source.cend()) ==
+                        std::max_element(source.cbegin(), source.cend()));
+                REQUIRE(std::minmax_element(poolstl::par_if(false), source.cbegin(), source.cend()) ==
+                        std::minmax_element(source.cbegin(), source.cend()));
+
+                // custom comparator
+                auto greater = std::greater<int>();
+                REQUIRE(std::min_element(poolstl::par.on(pool), source.begin(), source.end(), greater) ==
+                        std::min_element(source.begin(), source.end(), greater));
+                REQUIRE(std::max_element(poolstl::par.on(pool), source.begin(), source.end(), greater) ==
+                        std::max_element(source.begin(), source.end(), greater));
+                REQUIRE(std::minmax_element(poolstl::par.on(pool), source.begin(), source.end(), greater) ==
+                        std::minmax_element(source.begin(), source.end(), greater));
+
+                // raw pointers, narrow type
+                std::vector<std::int8_t> narrow(source.begin(), source.end());
+                const std::int8_t* data = narrow.data();
+                REQUIRE(std::min_element(poolstl::par.on(pool), data, data + num_iters) ==
+                        std::min_element(data, data + num_iters));
+                REQUIRE(std::max_element(poolstl::par.on(pool), data, data + num_iters) ==
+                        std::max_element(data, data + num_iters));
+                REQUIRE(std::minmax_element(poolstl::par.on(pool), data, data + num_iters) ==
+                        std::minmax_element(data, data + num_iters));
+            }
+
+            // floats, including signed zeros and NaNs
+            for (int variant = 0; variant < 3; ++variant) {
+                std::vector<double> source(num_iters);
+                for (int i = 0; i < num_iters; ++i) {
+                    source[i] = (double)((i * 7919LL) % 1000) - 500;
+                }
+                if (num_iters > 2) {
+                    if (variant == 1) {
+                        source[num_iters / 3] = -0.0;
+                        source[num_iters / 2] = 0.0;
+                    } else if (variant == 2) {
+                        source[num_iters / 2] = std::numeric_limits<double>::quiet_NaN();
+                        source[0] = std::numeric_limits<double>::quiet_NaN();
+                    }
+                }
+
+                REQUIRE(std::min_element(poolstl::par.on(pool), source.begin(), source.end()) ==
+                        std::min_element(source.begin(), source.end()));
+                REQUIRE(std::max_element(poolstl::par.on(pool), source.begin(), source.end()) ==
+                        std::max_element(source.begin(), source.end()));
+                if (variant != 2) {
+                    // sequential minmax_element compares elements in pairs, so with NaNs the result depends on
+                    // where the pairs fall
+                    REQUIRE(std::minmax_element(poolstl::par.on(pool), source.begin(), source.end()) ==
+                            std::minmax_element(source.begin(), source.end()));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Inputs for selection tests: scrambled, sorted, reversed, and scrambled with few distinct values.
+ */
+static std::vector<std::vector<int>> selection_inputs(int num_iters) {
+    std::vector<std::vector<int>> ret;
+    auto source = iota_vector(num_iters);
+    ret.push_back(source);
+    std::reverse(source.begin(), source.end());
+    ret.push_back(source);
+    scramble(source);
+    ret.push_back(source);
+    for (auto& v : source) {
+        v %= 5;
+    }
+    ret.push_back(source);
+    return ret;
+}
+
+TEST_CASE("nth_element", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (int num_iters : {0, 1, 2, 3, 10, 101, 100003}) {
+            for (const auto& source : selection_inputs(num_iters)) {
+                auto sorted = source;
+                std::sort(sorted.begin(), sorted.end());
+
+                for (int nth : {0, num_iters / 100, num_iters / 2, num_iters - 1, num_iters}) {
+                    if (nth < 0 || nth > num_iters) {
+                        continue;
+                    }
+                    for (int which_impl = 0; which_impl < 3; ++which_impl) {
+                        auto work = source;
+                        auto nth_it = work.begin() + nth;
+                        switch (which_impl) {
+                            case 0:
+                                std::nth_element(poolstl::par_if(false), work.begin(), nth_it, work.end());
+                                break;
+                            case 1:
+                                std::nth_element(poolstl::par.on(pool), work.begin(), nth_it, work.end());
+                                break;
+                            default:
+                                // reversed order
+                                std::nth_element(poolstl::par.on(pool), work.begin(), nth_it, work.end(),
+                                                 std::greater<int>());
+                                std::reverse(work.begin(), work.end());
+                                nth_it = work.begin() + (num_iters - nth - 1);
+                                if (nth == num_iters) {
+                                    nth_it = work.end();
+                                }
+                                break;
+                        }
+                        if (nth_it != work.end()) {
+                            REQUIRE(*nth_it == sorted[nth_it - work.begin()]);
+                            REQUIRE(std::all_of(work.begin(), nth_it, [&](int x) { return x <= *nth_it; }));
+                            REQUIRE(std::all_of(nth_it, work.end(), [&](int x) { return x >= *nth_it; }));
+                        }
+                        std::sort(work.begin(), work.end());
+                        REQUIRE(work == sorted);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("partial_sort", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (int num_iters : {0, 1, 2, 3, 10, 101, 100003}) {
+            for (const auto& source : selection_inputs(num_iters)) {
+                auto sorted = source;
+                std::sort(sorted.begin(), sorted.end());
+
+                for (int k : {0, 1, num_iters / 100, num_iters / 2, num_iters}) {
+                    if (k < 0 || k > num_iters) {
+                        continue;
+                    }
+                    {
+                        auto work = source;
+                        std::partial_sort(poolstl::par.on(pool), work.begin(), work.begin() + k, work.end());
+                        REQUIRE(std::equal(work.begin(), work.begin() + k, sorted.begin()));
+                        std::sort(work.begin(), work.end());
+                        REQUIRE(work == sorted);
+                    }
+                    {
+                        auto work = source;
+                        std::partial_sort(poolstl::par_if(false), work.begin(), work.begin() + k, work.end());
+                        REQUIRE(std::equal(work.begin(), work.begin() + k, sorted.begin()));
+                    }
+                    for (int dest_size : {k, k + 5}) {
+                        const int num_out = std::min(dest_size, num_iters);
+                        std::vector<int> expected(dest_size, -1);
+                        std::copy_n(sorted.cbegin(), num_out, expected.begin());
+
+                        std::vector<int> dest(dest_size, -1);
+                        auto end = std::partial_sort_copy(poolstl::par.on(pool), source.cbegin(), source.cend(),
+                                                          dest.begin(), dest.end());
+                        REQUIRE(end - dest.begin() == num_out);
+                        REQUIRE(dest == expected);
+
+                        // reversed order
+                        std::copy_n(sorted.crbegin(), num_out, expected.begin());
+                        end = std::partial_sort_copy(poolstl::par.on(pool), source.cbegin(), source.cend(),
+                                                     dest.begin(), dest.end(), std::greater<int>());
+                        REQUIRE(end - dest.begin() == num_out);
+                        REQUIRE(dest == expected);
+
+                        auto seq_end = std::partial_sort_copy(poolstl::par_if(false), source.cbegin(), source.cend(),
+                                                              dest.begin(), dest.end(), std::greater<int>());
+                        REQUIRE(seq_end == end);
+                        REQUIRE(dest == expected);
+                    }
+                }
+            }
+        }
+    }
+}
+
 TEST_CASE("partition", "[alg][algorithm]") {
     for (auto num_threads: test_thread_counts) {
         ttp::task_thread_pool pool(num_threads);
@@ -368,7 +861,313 @@ TEST_CASE("partition", "[alg][algorithm]") {
                 }
             }
         }
+
+        // large enough to split between threads
+        for (int num_iters : {10000, 100003}) {
+            auto source = iota_vector(num_iters);
+            scramble(source);
+
+            for (int pivot : {0, num_iters / 10, num_iters / 2, num_iters - 7, num_iters}) {
+                auto pred = [pivot] (const int& em) { return em < pivot; };
+                std::vector<int> work(source);
+                auto mid = std::partition(poolstl::par.on(pool), work.begin(), work.end(), pred);
+                REQUIRE(pivot == std::distance(work.begin(), mid));
+                REQUIRE(std::is_partitioned(work.begin(), work.end(), pred));
+                std::sort(work.begin(), work.end());
+                REQUIRE(work == iota_vector(num_iters));
+            }
+
+            // sorted input, so every chunk is already partitioned
+            std::vector<int> work = iota_vector(num_iters);
+            auto mid = std::partition(poolstl::par.on(pool), work.begin(), work.end(),
+                                      [num_iters] (const int& em) { return em < num_iters / 3; });
+            REQUIRE(num_iters / 3 == std::distance(work.begin(), mid));
+            REQUIRE(work == iota_vector(num_iters));
+
+            // quicksort partitions with it
+            work = source;
+            poolstl::pluggable_sort(poolstl::par.on(pool), work.begin(), work.end(), pdqsort);
+            REQUIRE(work == iota_vector(num_iters));
+        }
+    }
+}
+
+TEST_CASE("stable_partition", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (int num_iters : {0, 1, 2, 3, 10, 101, 10000, 100003}) {
+            std::vector<stable_sort_element> source(num_iters);
+            for (int i = 0; i < num_iters; ++i) {
+                source[i] = i;
+            }
+            scramble(source);
+
+            for (int pivot : {0, num_iters / 10, num_iters / 2, num_iters}) {
+                auto pred = [pivot] (const stable_sort_element& em) { return em.compared < pivot; };
+
+                std::vector<stable_sort_element> expected(source);
+                auto expected_mid = std::stable_partition(expected.begin(), expected.end(), pred);
+                auto same_order = [](const stable_sort_element& a, const stable_sort_element& b) {
+                    return a.compared == b.compared && a.nc == b.nc;
+                };
+                {
+                    std::vector<stable_sort_element> work(source);
+                    auto mid = std::stable_partition(poolstl::par_if(false), work.begin(), work.end(), pred);
+                    REQUIRE(std::distance(work.begin(), mid) == std::distance(expected.begin(), expected_mid));
+                    REQUIRE(std::equal(work.begin(), work.end(), expected.begin(), same_order));
+                }
+                {
+                    std::vector<stable_sort_element> work(source);
+                    auto mid = std::stable_partition(poolstl::par.on(pool), work.begin(), work.end(), pred);
+                    REQUIRE(std::distance(work.begin(), mid) == std::distance(expected.begin(), expected_mid));
+                    REQUIRE(std::equal(work.begin(), work.end(), expected.begin(), same_order));
+                }
+                {
+                    // partition_copy produces the same two halves
+                    std::vector<stable_sort_element> dest_true(source.size());
+                    std::vector<stable_sort_element> dest_false(source.size());
+                    auto ends = std::partition_copy(poolstl::par.on(pool), source.cbegin(), source.cend(),
+                                                    dest_true.begin(), dest_false.begin(), pred);
+                    REQUIRE(std::distance(dest_true.begin(), ends.first) ==
+                            std::distance(expected.begin(), expected_mid));
+                    REQUIRE(std::distance(dest_false.begin(), ends.second) ==
+                            std::distance(expected_mid, expected.end()));
+                    REQUIRE(std::equal(dest_true.begin(), ends.first, expected.begin(), same_order));
+                    REQUIRE(std::equal(dest_false.begin(), ends.second, expected_mid, same_order));
+
+                    auto seq_ends = std::partition_copy(poolstl::par_if(false), source.cbegin(), source.cend(),
+                                                        dest_true.begin(), dest_false.begin(), pred);
+                    REQUIRE(seq_ends == ends);
+                }
+            }
+        }
+
+        // strings are moved through the buffer and back
+        std::vector<std::string> words;
+        for (int i = 0; i < 20000; ++i) {
+            words.push_back(std::to_string(i) + " is a string long enough to live on the heap");
+        }
+        auto is_even = [](const std::string& w) { return (w[w.find(' ') - 1] - '0') % 2 == 0; };
+        std::vector<std::string> expected(words);
+        std::stable_partition(expected.begin(), expected.end(), is_even);
+        std::stable_partition(poolstl::par.on(pool), words.begin(), words.end(), is_even);
+        REQUIRE(words == expected);
+    }
+}
+
+TEST_CASE("remove_if", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (int num_iters : {0, 1, 2, 3, 10, 101, 10000, 100003}) {
+            auto source = iota_vector(num_iters);
+            scramble(source);
+
+            for (int modulus : {1, 2, 7, num_iters + 1}) {
+                auto pred = [modulus] (const int& em) { return em % modulus == 0; };
+
+                std::vector<int> expected(source);
+                expected.erase(std::remove_if(expected.begin(), expected.end(), pred), expected.end());
+                {
+                    std::vector<int> work(source);
+                    work.erase(std::remove_if(poolstl::par_if(false), work.begin(), work.end(), pred), work.end());
+                    REQUIRE(work == expected);
+                }
+                {
+                    std::vector<int> work(source);
+                    work.erase(std::remove_if(poolstl::par.on(pool), work.begin(), work.end(), pred), work.end());
+                    REQUIRE(work == expected);
+                }
+            }
+
+            if (num_iters > 0) {
+                int value = source[source.size() / 2];
+                std::vector<int> expected(source);
+                expected.erase(std::remove(expected.begin(), expected.end(), value), expected.end());
+                std::vector<int> work(source);
+                work.erase(std::remove(poolstl::par.on(pool), work.begin(), work.end(), value), work.end());
+                REQUIRE(work == expected);
+            }
+        }
+
+        // strings are moved through the buffer and back
+        std::vector<std::string> words;
+        for (int i = 0; i < 20000; ++i) {
+            words.push_back(std::to_string(i % 10) + " is a string long enough to live on the heap");
+        }
+        auto is_seven = [](const std::string& w) { return w[0] == '7'; };
+        std::vector<std::string> expected(words);
+        expected.erase(std::remove_if(expected.begin(), expected.end(), is_seven), expected.end());
+        words.erase(std::remove_if(poolstl::par.on(pool), words.begin(), words.end(), is_seven), words.end());
+        REQUIRE(words == expected);
+    }
+}
+
+TEST_CASE("search", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (int num_iters : {0, 1, 2, 3, 10, 101, 1000, 10000, 100003}) {
+            // small alphabet so that short patterns match often and long ones rarely
+            std::vector<char> haystack(num_iters);
+            std::mt19937 gen(num_iters);
+            for (auto& c : haystack) {
+                c = (char)('a' + gen() % 4);
+            }
+
+            for (int pattern_size : {0, 1, 2, 5, 9, 150}) {
+                for (int pattern_pos : {0, num_iters / 2, num_iters - pattern_size}) {
+                    // take the pattern from the haystack if it fits
+                    std::vector<char> pattern(pattern_size, 'z');
+                    if (pattern_pos >= 0 && pattern_pos + pattern_size <= num_iters) {
+                        std::copy_n(haystack.cbegin() + pattern_pos, pattern_size, pattern.begin());
+                    }
+
+                    REQUIRE(std::search(poolstl::par.on(pool), haystack.cbegin(), haystack.cend(),
+                                        pattern.cbegin(), pattern.cend()) ==
+                            std::search(haystack.cbegin(), haystack.cend(), pattern.cbegin(), pattern.cend()));
+                    REQUIRE(std::search(poolstl::par_if(false), haystack.cbegin(), haystack.cend(),
+                                        pattern.cbegin(), pattern.cend()) ==
+                            std::search(haystack.cbegin(), haystack.cend(), pattern.cbegin(), pattern.cend()));
+                    REQUIRE(std::find_end(poolstl::par.on(pool), haystack.cbegin(), haystack.cend(),
+                                          pattern.cbegin(), pattern.cend()) ==
+                            std::find_end(haystack.cbegin(), haystack.cend(), pattern.cbegin(), pattern.cend()));
+                    REQUIRE(std::find_end(poolstl::par_if(false), haystack.cbegin(), haystack.cend(),
+                                          pattern.cbegin(), pattern.cend()) ==
+                            std::find_end(haystack.cbegin(), haystack.cend(), pattern.cbegin(), pattern.cend()));
+
+                    // case-insensitive predicate
+                    auto same_letter = [](char a, char b) { return std::toupper(a) == std::toupper(b); };
+                    std::vector<char> upper(pattern.size());
+                    std::transform(pattern.cbegin(), pattern.cend(), upper.begin(),
+                                   [](char c) { return (char)std::toupper(c); });
+                    REQUIRE(std::search(poolstl::par.on(pool), haystack.cbegin(), haystack.cend(),
+                                        upper.cbegin(), upper.cend(), same_letter) ==
+                            std::search(haystack.cbegin(), haystack.cend(), pattern.cbegin(), pattern.cend()));
+                    REQUIRE(std::find_end(poolstl::par.on(pool), haystack.cbegin(), haystack.cend(),
+                                          upper.cbegin(), upper.cend(), same_letter) ==
+                            std::find_end(haystack.cbegin(), haystack.cend(), pattern.cbegin(), pattern.cend()));
+                }
+
+                for (char value : {'a', 'z'}) {
+                    REQUIRE(std::search_n(poolstl::par.on(pool), haystack.cbegin(), haystack.cend(),
+                                          pattern_size, value) ==
+                            std::search_n(haystack.cbegin(), haystack.cend(), pattern_size, value));
+                    REQUIRE(std::search_n(poolstl::par_if(false), haystack.cbegin(), haystack.cend(),
+                                          pattern_size, value) ==
+                            std::search_n(haystack.cbegin(), haystack.cend(), pattern_size, value));
+                    REQUIRE(std::search_n(poolstl::par.on(pool), haystack.cbegin(), haystack.cend(),
+                                          pattern_size, value, std::less<char>()) ==
+                            std::search_n(haystack.cbegin(), haystack.cend(), pattern_size, value,
+                                          std::less<char>()));
+                }
+            }
+
+            for (std::string needles : {"", "d", "xyd", "xyz"}) {
+                REQUIRE(std::find_first_of(poolstl::par.on(pool), haystack.cbegin(), haystack.cend(),
+                                           needles.cbegin(), needles.cend()) ==
+                        std::find_first_of(haystack.cbegin(), haystack.cend(), needles.cbegin(), needles.cend()));
+                REQUIRE(std::find_first_of(poolstl::par_if(false), haystack.cbegin(), haystack.cend(),
+                                           needles.cbegin(), needles.cend()) ==
+                        std::find_first_of(haystack.cbegin(), haystack.cend(), needles.cbegin(), needles.cend()));
+                REQUIRE(std::find_first_of(poolstl::par.on(pool), haystack.cbegin(), haystack.cend(),
+                                           needles.cbegin(), needles.cend(), std::greater<char>()) ==
+                        std::find_first_of(haystack.cbegin(), haystack.cend(), needles.cbegin(), needles.cend(),
+                                           std::greater<char>()));
+            }
+        }
+    }
+}
+
+TEST_CASE("set_operations", "[alg][algorithm]") {
+    // equivalent elements must be taken from the same positions as the sequential algorithms take them
+    auto order = [](const std::vector<stable_sort_element>& v) {
+        std::vector<int> ret;
+        for (auto& e : v) {
+            ret.push_back(e.nc);
+        }
+        return ret;
+    };
+    // sorted, with each key repeated `dups` times
+    auto make_set = [](int size, int dups, int key_offset) {
+        auto ret = iota_vector<stable_sort_element>(size);
+        for (auto& e : ret) {
+            e.compared = e.compared / dups + key_offset;
+        }
+        return ret;
+    };
+
+    using Vec = std::vector<stable_sort_element>;
+    using SetOp = std::function<Vec::iterator(const Vec&, const Vec&, Vec&)>;
+#define POOLSTL_TEST_SET_OP(NAME, POLICY) \
+    [&](const Vec& a, const Vec& b, Vec& dest) { \
+        return std::NAME(POLICY, a.cbegin(), a.cend(), b.cbegin(), b.cend(), dest.begin()); \
+    }
+
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+        // {parallel, sequential}
+        std::vector<std::pair<SetOp, SetOp>> ops = {
+            {POOLSTL_TEST_SET_OP(set_difference, poolstl::par.on(pool)),
+             POOLSTL_TEST_SET_OP(set_difference, poolstl::par_if(false))},
+            {POOLSTL_TEST_SET_OP(set_intersection, poolstl::par.on(pool)),
+             POOLSTL_TEST_SET_OP(set_intersection, poolstl::par_if(false))},
+            {POOLSTL_TEST_SET_OP(set_symmetric_difference, poolstl::par.on(pool)),
+             POOLSTL_TEST_SET_OP(set_symmetric_difference, poolstl::par_if(false))},
+            {POOLSTL_TEST_SET_OP(set_union, poolstl::par.on(pool)),
+             POOLSTL_TEST_SET_OP(set_union, poolstl::par_if(false))},
+        };
+
+        std::vector<int> sizes(test_arr_sizes.begin(), test_arr_sizes.end());
+        sizes.push_back(40000);
+        for (auto num_iters : sizes) {
+            // b overlaps the upper part of a, with different multiplicities
+            std::vector<std::pair<Vec, Vec>> inputs = {
+                {make_set(num_iters, 3, 0), make_set(num_iters, 2, num_iters / 6)},
+                {make_set(num_iters, 2, num_iters / 6), make_set(num_iters, 3, 0)},
+                {make_set(num_iters, 1, 0), make_set(num_iters / 2, 1000, 7)},
+                {make_set(num_iters, 3, 0), Vec()},
+                {Vec(), make_set(num_iters, 3, 0)},
+            };
+
+            for (auto& input : inputs) {
+                const Vec& a = input.first;
+                const Vec& b = input.second;
+                for (auto& op : ops) {
+                    Vec expected(a.size() + b.size());
+                    expected.erase(op.second(a, b, expected), expected.end());
+
+                    Vec dest(a.size() + b.size());
+                    auto ret = op.first(a, b, dest);
+                    REQUIRE(ret - dest.begin() == (std::ptrdiff_t)expected.size());
+                    dest.erase(ret, dest.end());
+                    REQUIRE(dest == expected);
+                    REQUIRE(order(dest) == order(expected));
+                }
+
+                REQUIRE(std::includes(poolstl::par.on(pool), a.cbegin(), a.cend(), b.cbegin(), b.cend()) ==
+                        std::includes(a.cbegin(), a.cend(), b.cbegin(), b.cend()));
+            }
+
+            // includes() with subsets that do and do not fit
+            Vec a = make_set(num_iters, 3, 0);
+            Vec b;
+            for (std::size_t i = 0; i < a.size(); i += 2) {
+                b.push_back(a[i]);
+            }
+            REQUIRE(std::includes(poolstl::par.on(pool), a.cbegin(), a.cend(), b.cbegin(), b.cend()));
+            REQUIRE(std::includes(poolstl::par_if(false), a.cbegin(), a.cend(), b.cbegin(), b.cend()));
+            if (!b.empty()) {
+                // every key of a appears 3 times
+                const auto extra = b[b.size() / 2];
+                b.insert(b.begin() + (std::ptrdiff_t)b.size() / 2, 3, extra);
+                REQUIRE_FALSE(std::includes(poolstl::par.on(pool), a.cbegin(), a.cend(), b.cbegin(), b.cend(),
+                                            std::less<stable_sort_element>()));
+            }
+        }
     }
+#undef POOLSTL_TEST_SET_OP
 }
 
 TEST_CASE("sort", "[alg][algorithm]") {
@@ -441,29 +1240,228 @@ TEST_CASE("sort", "[alg][algorithm]") {
     }
 }
 
-TEST_CASE("stable_sort", "[alg][algorithm]") {
+TEST_CASE("samplesort", "[alg][algorithm]") {
     for (auto num_threads : test_thread_counts) {
         ttp::task_thread_pool pool(num_threads);
 
-        for (auto num_iters : test_arr_sizes) {
-            for (int scramble_type = 0; scramble_type <= 2; ++scramble_type) {
-                auto source = iota_vector<stable_sort_element>(num_iters);
-                for (auto& s: source) {
-                    s.compared /= 3;
-                    s.nc = (int)rng();
-                }
-
+        // large enough for several buckets
+        for (int num_iters : {0, 101, 5000, 50000}) {
+            for (int scramble_type = 0; scramble_type <= 3; ++scramble_type) {
+                auto source = iota_vector(num_iters);
                 switch (scramble_type) {
                     case 0: std::reverse(source.begin(), source.end()); break;
                     case 1: scramble(source); break;
+                    case 2:
+                        // many duplicates
+                        for (auto& x : source) {
+                            x %= 3;
+                        }
+                        scramble(source);
+                        break;
                     default: break;
                 }
 
-                std::vector<stable_sort_element> dest1(source);
-                std::stable_sort(dest1.begin(), dest1.end());
+                std::vector<int> dest1(source);
+                std::sort(dest1.begin(), dest1.end());
 
                 {
-                    std::vector<stable_sort_element> work(source);
+                    std::vector<int> work(source);
+                    poolstl::pluggable_samplesort(poolstl::par.on(pool), work.begin(), work.end());
+                    REQUIRE(dest1 == work);
+                }
+                {
+                    std::vector<int> work(source);
+                    poolstl::pluggable_samplesort(poolstl::par.on(pool), work.begin(), work.end(), pdqsort);
+                    REQUIRE(dest1 == work);
+                }
+                {
+                    std::vector<int> work(source);
+                    poolstl::pluggable_samplesort(poolstl::par_if(false), work.begin(), work.end(), pdqsort);
+                    REQUIRE(dest1 == work);
+                }
+                {
+                    std::vector<int> work(source);
+                    std::sort(poolstl::par.on(pool), work.begin(), work.end(), std::greater<int>());
+                    REQUIRE(std::equal(dest1.rbegin(), dest1.rend(), work.begin()));
+                }
+                {
+                    // elements with non-trivial moves
+                    std::vector<std::string> work;
+                    for (auto x : source) {
+                        work.push_back(std::to_string(x));
+                    }
+                    std::vector<std::string> sdest(work);
+                    std::sort(sdest.begin(), sdest.end());
+                    std::sort(poolstl::par.on(pool), work.begin(), work.end());
+                    REQUIRE(sdest == work);
+                }
+            }
+        }
+
+        // a throwing comparator leaves a permutation of the input
+        auto source = iota_vector(50000);
+        scramble(source);
+        std::vector<int> work(source);
+        std::atomic<int> num_comparisons{0};
+        auto throwing_less = [&](int a, int b) {
+            if (a == 12345 && ++num_comparisons > 3) {
+                throw std::runtime_error("oops");
+            }
+            return a < b;
+        };
+        try {
+            poolstl::pluggable_samplesort(poolstl::par.on(pool), work.begin(), work.end(), throwing_less,
+                                          std::sort<std::vector<int>::iterator, decltype(throwing_less)>);
+        } catch (std::runtime_error&) {}
+        std::sort(work.begin(), work.end());
+        std::sort(source.begin(), source.end());
+        REQUIRE(source == work);
+    }
+}
+
+TEST_CASE("mergesort_large", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        // large enough that merges are split between threads
+        for (int num_iters : {20000, 100000}) {
+            auto source = iota_vector<stable_sort_element>(num_iters);
+            for (auto& e : source) {
+                e.compared /= 7;
+            }
+            scramble(source);
+
+            std::vector<stable_sort_element> dest1(source);
+            std::stable_sort(dest1.begin(), dest1.end());
+
+            std::vector<stable_sort_element> work(source);
+            poolstl::pluggable_mergesort(poolstl::par.on(pool), work.begin(), work.end(),
+                                         std::less<stable_sort_element>(),
+                                         std::stable_sort, std::inplace_merge);
+            // stable merges of stable sorts keep equal elements in order
+            auto order = [](const std::vector<stable_sort_element>& v) {
+                std::vector<int> ret;
+                for (auto& e : v) {
+                    ret.push_back(e.nc);
+                }
+                return ret;
+            };
+            REQUIRE(dest1 == work);
+            REQUIRE(order(dest1) == order(work));
+
+            std::vector<int> ints(source.size());
+            std::transform(source.begin(), source.end(), ints.begin(),
+                           [](const stable_sort_element& e) { return e.nc; });
+            std::vector<int> idest(ints);
+            std::sort(idest.begin(), idest.end());
+            poolstl::pluggable_mergesort(poolstl::par.on(pool), ints.begin(), ints.end(), std::less<int>(),
+                                         pdqsort_branchless, adapted_pipm_inplace_merge);
+            REQUIRE(idest == ints);
+        }
+    }
+}
+
+TEST_CASE("radix_sort", "[alg][algorithm]") {
+    std::vector<int> sizes(test_arr_sizes.begin(), test_arr_sizes.end());
+    sizes.push_back(5000);
+    sizes.push_back(50000);
+
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (auto num_iters : sizes) {
+            // signed integers, including negatives
+            {
+                auto source = iota_vector(num_iters, -num_iters / 2);
+                scramble(source);
+                std::vector<int> dest1(source);
+                std::sort(dest1.begin(), dest1.end());
+
+                std::vector<int> work(source);
+                poolstl::radix_sort(poolstl::par.on(pool), work.begin(), work.end());
+                REQUIRE(dest1 == work);
+
+                work = source;
+                poolstl::radix_sort(poolstl::par_if(false), work.begin(), work.end());
+                REQUIRE(dest1 == work);
+            }
+            // unsigned 64-bit keys that differ in the high digits only
+            {
+                std::vector<std::uint64_t> source;
+                for (int i = 0; i < num_iters; ++i) {
+                    source.push_back((std::uint64_t)rng() << 40);
+                }
+                std::vector<std::uint64_t> dest1(source);
+                std::sort(dest1.begin(), dest1.end());
+
+                poolstl::radix_sort(poolstl::par.on(pool), source.begin(), source.end());
+                REQUIRE(dest1 == source);
+            }
+            // floating point
+            {
+                std::vector<double> source;
+                for (int i = 0; i < num_iters; ++i) {
+                    source.push_back(((double)rng() - rng.max() / 2.0) / 1000.0);
+                }
+                if (num_iters > 2) {
+                    source[0] = std::numeric_limits<double>::infinity();
+                    source[1] = -std::numeric_limits<double>::infinity();
+                    source[2] = 0.0;
+                }
+                std::vector<double> dest1(source);
+                std::sort(dest1.begin(), dest1.end());
+
+                poolstl::radix_sort(poolstl::par.on(pool), source.begin(), source.end());
+                REQUIRE(dest1 == source);
+            }
+            // stable sort of records by key
+            {
+                auto source = iota_vector<stable_sort_element>(num_iters);
+                for (auto& e : source) {
+                    e.compared /= 3;
+                }
+                scramble(source);
+                std::vector<stable_sort_element> dest1(source);
+                std::stable_sort(dest1.begin(), dest1.end());
+
+                poolstl::radix_sort(poolstl::par.on(pool), source.begin(), source.end(),
+                                    [](const stable_sort_element& e) { return (float)e.compared; });
+                auto fields = [](const std::vector<stable_sort_element>& v) {
+                    std::vector<std::pair<int, int>> ret;
+                    for (auto& e : v) {
+                        ret.emplace_back(e.compared, e.nc);
+                    }
+                    return ret;
+                };
+                REQUIRE(fields(dest1) == fields(source));
+            }
+        }
+    }
+}
+
+TEST_CASE("stable_sort", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (auto num_iters : test_arr_sizes) {
+            for (int scramble_type = 0; scramble_type <= 2; ++scramble_type) {
+                auto source = iota_vector<stable_sort_element>(num_iters);
+                for (auto& s: source) {
+                    s.compared /= 3;
+                    s.nc = (int)rng();
+                }
+
+                switch (scramble_type) {
+                    case 0: std::reverse(source.begin(), source.end()); break;
+                    case 1: scramble(source); break;
+                    default: break;
+                }
+
+                std::vector<stable_sort_element> dest1(source);
+                std::stable_sort(dest1.begin(), dest1.end());
+
+                {
+                    std::vector<stable_sort_element> work(source);
                     std::stable_sort(poolstl::par_if(false), work.begin(), work.end());
                     REQUIRE(dest1 == work);
                 }
@@ -479,6 +1477,73 @@ TEST_CASE("stable_sort", "[alg][algorithm]") {
                 }
             }
         }
+
+        // large enough for several runs and merge rounds
+        auto order = [](const std::vector<stable_sort_element>& v) {
+            std::vector<int> ret;
+            for (auto& e : v) {
+                ret.push_back(e.nc);
+            }
+            return ret;
+        };
+        for (int num_iters : {20000, 70000}) {
+            auto source = iota_vector<stable_sort_element>(num_iters);
+            for (auto& s: source) {
+                s.compared /= 5;
+            }
+            scramble(source);
+
+            std::vector<stable_sort_element> dest1(source);
+            std::stable_sort(dest1.begin(), dest1.end());
+            {
+                std::vector<stable_sort_element> work(source);
+                std::stable_sort(poolstl::par.on(pool), work.begin(), work.end());
+                REQUIRE(order(dest1) == order(work));
+            }
+            {
+                // elements whose moves may throw
+                struct throwing_move_element {
+                    stable_sort_element e;
+                    explicit throwing_move_element(const stable_sort_element& e): e(e) {}
+                    throwing_move_element(const throwing_move_element& other): e(other.e) {}
+                    throwing_move_element& operator=(const throwing_move_element& other) {
+                        e = other.e;
+                        return *this;
+                    }
+                };
+                std::vector<throwing_move_element> work;
+                for (auto& e : source) {
+                    work.emplace_back(e);
+                }
+                std::stable_sort(poolstl::par.on(pool), work.begin(), work.end(),
+                                 [](const throwing_move_element& a, const throwing_move_element& b) {
+                                     return a.e < b.e;
+                                 });
+                std::vector<stable_sort_element> unwrapped;
+                for (auto& w : work) {
+                    unwrapped.push_back(w.e);
+                }
+                REQUIRE(order(dest1) == order(unwrapped));
+            }
+        }
+
+        // a throwing comparator leaves a permutation of the input
+        auto source = iota_vector(50000);
+        scramble(source);
+        std::vector<int> work(source);
+        std::atomic<int> num_comparisons{0};
+        auto throwing_less = [&](int a, int b) {
+            if (a == 12345 && ++num_comparisons > 20) {
+                throw std::runtime_error("oops");
+            }
+            return a < b;
+        };
+        try {
+            std::stable_sort(poolstl::par.on(pool), work.begin(), work.end(), throwing_less);
+        } catch (std::runtime_error&) {}
+        std::sort(work.begin(), work.end());
+        std::sort(source.begin(), source.end());
+        REQUIRE(source == work);
     }
 }
 
@@ -538,6 +1603,63 @@ TEST_CASE("transform_2", "[alg][algorithm]") {
 }
 
 #if POOLSTL_HAVE_CXX17_LIB
+TEST_CASE("unique", "[alg][algorithm]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (int num_iters : {0, 1, 2, 3, 10, 101, 10000, 100003}) {
+            // run lengths chosen so that duplicate runs straddle chunk boundaries
+            for (int run_length : {1, 2, 7, 1000, num_iters + 1}) {
+                std::vector<int> source(num_iters);
+                for (int i = 0; i < num_iters; ++i) {
+                    source[i] = i / run_length;
+                }
+
+                std::vector<int> expected(source);
+                expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+                {
+                    std::vector<int> work(source);
+                    work.erase(std::unique(poolstl::par_if(false), work.begin(), work.end()), work.end());
+                    REQUIRE(work == expected);
+                }
+                {
+                    std::vector<int> work(source);
+                    work.erase(std::unique(poolstl::par.on(pool), work.begin(), work.end()), work.end());
+                    REQUIRE(work == expected);
+                }
+                {
+                    std::vector<int> dest(source.size(), -1);
+                    auto end = std::unique_copy(poolstl::par.on(pool), source.cbegin(), source.cend(), dest.begin());
+                    REQUIRE(std::vector<int>(dest.begin(), end) == expected);
+                    REQUIRE(std::all_of(end, dest.end(), [](int v) { return v == -1; }));
+
+                    auto seq_end = std::unique_copy(poolstl::par_if(false), source.cbegin(), source.cend(),
+                                                    dest.begin());
+                    REQUIRE(seq_end == end);
+                }
+            }
+
+            // custom predicate, keeps the first of each group
+            std::vector<stable_sort_element> source(num_iters);
+            for (int i = 0; i < num_iters; ++i) {
+                source[i] = i / 3;
+            }
+            auto same_group = [](const stable_sort_element& a, const stable_sort_element& b) {
+                return a.compared == b.compared;
+            };
+            auto same_order = [](const stable_sort_element& a, const stable_sort_element& b) {
+                return a.compared == b.compared && a.nc == b.nc;
+            };
+            std::vector<stable_sort_element> expected(source);
+            expected.erase(std::unique(expected.begin(), expected.end(), same_group), expected.end());
+            std::vector<stable_sort_element> work(source);
+            work.erase(std::unique(poolstl::par.on(pool), work.begin(), work.end(), same_group), work.end());
+            REQUIRE(work.size() == expected.size());
+            REQUIRE(std::equal(work.begin(), work.end(), expected.begin(), same_order));
+        }
+    }
+}
+
 TEST_CASE("exclusive_scan", "[alg][algorithm]") {
     for (auto num_threads : test_thread_counts) {
         ttp::task_thread_pool pool(num_threads);
@@ -578,6 +1700,146 @@ TEST_CASE("exclusive_scan", "[alg][algorithm]") {
 }
 #endif
 
+#if POOLSTL_HAVE_CXX17_LIB
+TEST_CASE("inclusive_scan", "[alg][numeric]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (auto num_iters : test_arr_sizes) {
+            auto v = iota_vector(num_iters);
+            std::vector<int> dest1(v.size());
+            std::vector<int> dest2(v.size());
+
+            auto seq_res = std::inclusive_scan(poolstl::par_if(false), v.cbegin(), v.cend(), dest1.begin());
+            auto par_res = std::inclusive_scan(poolstl::par.on(pool),  v.cbegin(), v.cend(), dest2.begin());
+            // test return value
+            REQUIRE((par_res - dest2.begin()) == (seq_res - dest1.begin()));
+            REQUIRE(dest1 == dest2);
+
+            // with init
+            std::inclusive_scan(poolstl::par_if(false), v.cbegin(), v.cend(), dest1.begin(), std::plus<>(), 10);
+            std::inclusive_scan(poolstl::par.on(pool),  v.cbegin(), v.cend(), dest2.begin(), std::plus<>(), 10);
+            REQUIRE(dest1 == dest2);
+
+            // test in-place
+            std::inclusive_scan(poolstl::par.on(pool), v.begin(), v.end(), v.begin(), std::plus<>(), 10);
+            REQUIRE(v == dest2);
+
+            // op without an identity of T{}
+            std::vector<unsigned> u(num_iters);
+            std::iota(u.begin(), u.end(), 1U);
+            std::vector<unsigned> udest1(u.size());
+            std::vector<unsigned> udest2(u.size());
+            std::inclusive_scan(poolstl::par_if(false), u.cbegin(), u.cend(), udest1.begin(), std::multiplies<>());
+            std::inclusive_scan(poolstl::par.on(pool),  u.cbegin(), u.cend(), udest2.begin(), std::multiplies<>());
+            REQUIRE(udest1 == udest2);
+            std::exclusive_scan(poolstl::par_if(false), u.cbegin(), u.cend(), udest1.begin(), 1U, std::multiplies<>());
+            std::exclusive_scan(poolstl::par.on(pool),  u.cbegin(), u.cend(), udest2.begin(), 1U, std::multiplies<>());
+            REQUIRE(udest1 == udest2);
+
+            // test commutativity
+            {
+                std::vector<std::string> sv;
+                sv.reserve(v.size());
+                for (auto val : v) {
+                    sv.emplace_back(std::to_string(val));
+                }
+                std::vector<std::string> sdest1(sv.size());
+                std::vector<std::string> sdest2(sv.size());
+
+                std::inclusive_scan(poolstl::par_if(false), sv.cbegin(), sv.cend(), sdest1.begin());
+                std::inclusive_scan(poolstl::par.on(pool),  sv.cbegin(), sv.cend(), sdest2.begin());
+                REQUIRE(sdest1 == sdest2);
+            }
+        }
+    }
+}
+
+TEST_CASE("scan_lookback", "[alg][numeric]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (auto num_iters : test_arr_sizes) {
+            // a grain of 1 gives enough tiles for the single-pass scan
+            for (std::size_t grain : {1, 2, 5}) {
+                auto v = iota_vector(num_iters);
+                std::vector<int> dest1(v.size());
+                std::vector<int> dest2(v.size());
+
+                std::exclusive_scan(poolstl::par_if(false), v.cbegin(), v.cend(), dest1.begin(), 10);
+                auto par_res = std::exclusive_scan(poolstl::par.on(pool).with_grain(grain),
+                                                   v.cbegin(), v.cend(), dest2.begin(), 10);
+                REQUIRE((par_res - dest2.begin()) == num_iters);
+                REQUIRE(dest1 == dest2);
+
+                std::inclusive_scan(poolstl::par_if(false), v.cbegin(), v.cend(), dest1.begin());
+                std::inclusive_scan(poolstl::par.on(pool).with_grain(grain), v.cbegin(), v.cend(), dest2.begin());
+                REQUIRE(dest1 == dest2);
+
+                // test in-place
+                std::inclusive_scan(poolstl::par.on(pool).with_grain(grain), v.begin(), v.end(), v.begin());
+                REQUIRE(v == dest1);
+
+                // nested parallel calls help the pool while a tile is in progress
+                auto nested = [&](int x) {
+                    std::vector<int> w(3, x);
+                    return std::reduce(poolstl::par.on(pool), w.cbegin(), w.cend());
+                };
+                std::transform_inclusive_scan(poolstl::par_if(false), v.cbegin(), v.cend(), dest1.begin(),
+                                              std::plus<>(), nested);
+                std::transform_inclusive_scan(poolstl::par.on(pool).with_grain(grain), v.cbegin(), v.cend(),
+                                              dest2.begin(), std::plus<>(), nested);
+                REQUIRE(dest1 == dest2);
+            }
+        }
+
+        // exceptions are propagated
+        auto v = iota_vector(1000);
+        std::vector<int> dest(v.size());
+        REQUIRE_THROWS_AS(std::inclusive_scan(poolstl::par.on(pool).with_grain(1), v.cbegin(), v.cend(),
+                                              dest.begin(), [](int a, int b) {
+            if (b == 500) {
+                throw std::runtime_error("oops");
+            }
+            return a + b;
+        }), std::runtime_error);
+    }
+}
+
+TEST_CASE("transform_scan", "[alg][numeric]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        for (auto num_iters : test_arr_sizes) {
+            auto v = iota_vector(num_iters);
+            std::vector<long> dest1(v.size());
+            std::vector<long> dest2(v.size());
+            auto doubler = [](int x) { return 2L * x; };
+
+            auto seq_res = std::transform_inclusive_scan(poolstl::par_if(false), v.cbegin(), v.cend(), dest1.begin(),
+                                                         std::plus<>(), doubler);
+            auto par_res = std::transform_inclusive_scan(poolstl::par.on(pool),  v.cbegin(), v.cend(), dest2.begin(),
+                                                         std::plus<>(), doubler);
+            REQUIRE((par_res - dest2.begin()) == (seq_res - dest1.begin()));
+            REQUIRE(dest1 == dest2);
+
+            std::transform_inclusive_scan(poolstl::par_if(false), v.cbegin(), v.cend(), dest1.begin(),
+                                          std::plus<>(), doubler, 10L);
+            std::transform_inclusive_scan(poolstl::par.on(pool),  v.cbegin(), v.cend(), dest2.begin(),
+                                          std::plus<>(), doubler, 10L);
+            REQUIRE(dest1 == dest2);
+
+            seq_res = std::transform_exclusive_scan(poolstl::par_if(false), v.cbegin(), v.cend(), dest1.begin(),
+                                                    10L, std::plus<>(), doubler);
+            par_res = std::transform_exclusive_scan(poolstl::par.on(pool),  v.cbegin(), v.cend(), dest2.begin(),
+                                                    10L, std::plus<>(), doubler);
+            REQUIRE((par_res - dest2.begin()) == (seq_res - dest1.begin()));
+            REQUIRE(dest1 == dest2);
+        }
+    }
+}
+#endif
+
 #if POOLSTL_HAVE_CXX17_LIB
 TEST_CASE("reduce", "[alg][numeric]") {
     for (auto num_threads : test_thread_counts) {
@@ -589,7 +1851,13 @@ TEST_CASE("reduce", "[alg][numeric]") {
             auto seq = std::reduce(poolstl::par_if(false), v.cbegin(), v.cend());
             auto par = std::reduce(poolstl::par.on(pool),  v.cbegin(), v.cend());
             REQUIRE(seq == par);
+            REQUIRE(std::reduce(poolstl::par.on(pool), v.cbegin(), v.cend(), 1000) == seq + 1000);
         }
+
+        // init is applied once however the range is chunked
+        std::vector<long> ones(1000000, 1);
+        REQUIRE(std::reduce(poolstl::par.on(pool), ones.cbegin(), ones.cend(), 1000L) == 1001000);
+        REQUIRE(std::reduce(poolstl::par.on(pool).with_grain(1000), ones.cbegin(), ones.cend(), 1000L) == 1001000);
     }
 }
 #endif
@@ -606,6 +1874,8 @@ TEST_CASE("transform_reduce_1", "[alg][numeric]") {
             auto seq = std::transform_reduce(poolstl::par_if(false), v.cbegin(), v.cend(), 0, std::plus<>(), doubler);
             auto par = std::transform_reduce(poolstl::par.on(pool),  v.cbegin(), v.cend(), 0, std::plus<>(), doubler);
             REQUIRE(seq == par);
+            REQUIRE(std::transform_reduce(poolstl::par.on(pool).with_grain(4), v.cbegin(), v.cend(), 1000,
+                                          std::plus<>(), doubler) == seq + 1000);
         }
     }
 }
@@ -621,11 +1891,447 @@ TEST_CASE("transform_reduce_2", "[alg][numeric]") {
             auto seq = std::transform_reduce(poolstl::par_if(false), v1.cbegin(), v1.cend(), v2.cbegin(), 0);
             auto par = std::transform_reduce(poolstl::par.on(pool),  v1.cbegin(), v1.cend(), v2.cbegin(), 0);
             REQUIRE(seq == par);
+            REQUIRE(std::transform_reduce(poolstl::par.on(pool).with_grain(4), v1.cbegin(), v1.cend(), v2.cbegin(),
+                                          1000) == seq + 1000);
+        }
+    }
+}
+#endif
+
+TEST_CASE("work_stealing", "[pool]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        // Tasks submitted from a worker go to that worker's own deque. The other workers must steal them.
+        std::atomic<int> sum{0};
+        auto outer = pool.submit([&]() {
+            std::vector<std::future<void>> futures;
+            for (int i = 0; i < 100; ++i) {
+                futures.emplace_back(pool.submit([&sum]() { ++sum; }));
+            }
+            if (pool.get_num_threads() > 1) {
+                poolstl::internal::get_futures(futures);
+            }
+        });
+        outer.get();
+        pool.wait_for_tasks();
+        REQUIRE(sum == 100);
+        REQUIRE(pool.get_num_tasks() == 0);
+
+        // Queued tasks survive a change in thread count.
+        pool.pause();
+        for (int i = 0; i < 10; ++i) {
+            pool.submit_detach([&sum]() { ++sum; });
+        }
+        REQUIRE(pool.get_num_queued_tasks() == 10);
+        pool.set_num_threads(pool.get_num_threads() + 1);
+        pool.unpause();
+        pool.wait_for_tasks();
+        REQUIRE(sum == 110);
+
+        // Changing the thread count while another thread helps run tasks.
+        std::atomic<bool> helping{true};
+        std::thread helper([&]() {
+            while (helping) {
+                pool.run_pending_task();
+            }
+        });
+        for (int i = 0; i < 20; ++i) {
+            pool.submit_detach([&sum]() { ++sum; });
+            pool.set_num_threads(1 + (unsigned int)(i % 3));
+        }
+        pool.wait_for_tasks();
+        helping = false;
+        helper.join();
+        REQUIRE(sum == 130);
+    }
+}
+
+TEST_CASE("injection_queue", "[pool]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        // More tasks than fit in the injection ring, from several threads at once.
+        constexpr int num_producers = 4;
+        constexpr int tasks_per_producer = 1000;
+        std::atomic<int> sum{0};
+        {
+            std::vector<std::thread> producers;
+            for (int p = 0; p < num_producers; ++p) {
+                producers.emplace_back([&]() {
+                    for (int i = 0; i < tasks_per_producer; ++i) {
+                        pool.submit_detach([&sum]() { ++sum; });
+                    }
+                });
+            }
+            for (auto& producer : producers) {
+                producer.join();
+            }
+        }
+        pool.wait_for_tasks();
+        REQUIRE(sum == num_producers * tasks_per_producer);
+        REQUIRE(pool.get_num_tasks() == 0);
+
+        // Tasks that spill over the ring are also held while paused, and dropped by clear_task_queue().
+        pool.pause();
+        for (int i = 0; i < 2000; ++i) {
+            pool.submit_detach([&sum]() { ++sum; });
         }
+        REQUIRE(pool.get_num_queued_tasks() == 2000);
+        REQUIRE(sum == num_producers * tasks_per_producer);
+        pool.clear_task_queue();
+        REQUIRE(pool.get_num_queued_tasks() == 0);
+
+        for (int i = 0; i < 2000; ++i) {
+            pool.submit_detach([&sum]() { ++sum; });
+        }
+        pool.unpause();
+        pool.wait_for_tasks();
+        REQUIRE(sum == num_producers * tasks_per_producer + 2000);
     }
 }
+
+TEST_CASE("idle_strategy", "[pool]") {
+    for (auto idle : {ttp::idle_strategy(), ttp::idle_strategy::park(), ttp::idle_strategy(0, 100),
+                      ttp::idle_strategy(1000000, 0)}) {
+        ttp::task_thread_pool pool(3, idle);
+        REQUIRE(pool.get_idle_strategy().spin_count == idle.spin_count);
+        REQUIRE(pool.get_idle_strategy().yield_count == idle.yield_count);
+
+        // back-to-back calls, some of which find the workers still polling
+        std::vector<int> v = iota_vector(1000);
+        for (int i = 0; i < 100; ++i) {
+            REQUIRE(std::count(poolstl::par.on(pool), v.cbegin(), v.cend(), i) == 1);
+        }
+
+        // polling workers must respect pause
+        std::atomic<int> sum{0};
+        pool.pause();
+        pool.submit_detach([&sum]() { ++sum; });
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        REQUIRE(sum == 0);
+        pool.unpause();
+        pool.wait_for_tasks();
+        REQUIRE(sum == 1);
+    }
+}
+
+TEST_CASE("cpu_affinity", "[pool]") {
+    {
+        // not pinned by default
+        ttp::task_thread_pool pool(3);
+        REQUIRE(pool.get_worker_cpus() == std::vector<int>(3, -1));
+    }
+
+    // a CPU we are allowed to run on, or -1 if pinning is not supported
+    const int first_cpu = ttp::cpu_affinity::compact().assign(1).front();
+    for (auto affinity : {ttp::cpu_affinity::compact(), ttp::cpu_affinity::scatter(),
+                          ttp::cpu_affinity::list({first_cpu})}) {
+        ttp::task_thread_pool pool(3, affinity);
+        auto cpus = pool.get_worker_cpus();
+        REQUIRE(cpus.size() == 3);
+        REQUIRE(cpus == affinity.assign(3));
+
+#if defined(__linux__)
+        // the workers only run on their CPUs
+        std::sort(cpus.begin(), cpus.end());
+        REQUIRE(cpus.front() >= 0);
+        std::mutex mutex;
+        std::vector<int> seen;
+        for (int i = 0; i < 50; ++i) {
+            pool.submit_detach([&]() {
+                const int cpu = sched_getcpu();
+                const std::lock_guard<std::mutex> lock(mutex);
+                seen.push_back(cpu);
+            });
+        }
+        pool.wait_for_tasks();
+        for (int cpu : seen) {
+            REQUIRE(std::binary_search(cpus.begin(), cpus.end(), cpu));
+        }
+
+        // the mapping is redone when the thread count changes
+        pool.set_num_threads(5);
+        REQUIRE(pool.get_worker_cpus() == affinity.assign(5));
+#endif
+    }
+
+#if defined(__linux__)
+    if (first_cpu >= 0) {
+        // a worker is pinned before it runs its first task
+        for (int i = 0; i < 10; ++i) {
+            ttp::task_thread_pool pool(1, ttp::cpu_affinity::list({first_cpu}));
+            REQUIRE(pool.submit([]() { return sched_getcpu(); }).get() == pool.get_worker_cpus()[0]);
+        }
+    }
 #endif
 
+    {
+        // compact() and scatter() use every allowed CPU once before reusing any
+        const unsigned int num_cpus = std::max(std::thread::hardware_concurrency(), 1U);
+        for (auto affinity : {ttp::cpu_affinity::compact(), ttp::cpu_affinity::scatter()}) {
+            auto cpus = affinity.assign(num_cpus);
+            if (cpus.front() < 0) {
+                continue;  // pinning not supported
+            }
+            std::sort(cpus.begin(), cpus.end());
+            REQUIRE(std::unique(cpus.begin(), cpus.end()) == cpus.end());
+        }
+    }
+}
+
+TEST_CASE("pooled_future", "[pool]") {
+    ttp::task_thread_pool pool(2);
+
+    for (int i = 0; i < 1000; ++i) {
+        auto future = poolstl::internal::submit_pooled(pool, [](int x) { return std::to_string(x); }, i);
+        REQUIRE(future.get() == std::to_string(i));
+    }
+
+    {
+        auto future = poolstl::internal::submit_pooled(pool, []() { throw std::runtime_error("oops"); });
+        REQUIRE_THROWS_AS(future.get(), std::runtime_error);
+    }
+
+    {
+        // dropped task
+        pool.pause();
+        auto future = poolstl::internal::submit_pooled(pool, []() { return 1; });
+        pool.clear_task_queue();
+        pool.unpause();
+        REQUIRE_THROWS_AS(future.get(), std::future_error);
+    }
+
+    {
+        // exceptions propagate out of parallel algorithms
+        std::vector<int> v = iota_vector(100);
+        REQUIRE_THROWS_AS(std::for_each(poolstl::par.on(pool), v.cbegin(), v.cend(), [](int x) {
+            if (x == 50) {
+                throw std::runtime_error("oops");
+            }
+        }), std::runtime_error);
+    }
+}
+
+TEST_CASE("task_latch", "[pool]") {
+    ttp::task_thread_pool pool(3);
+
+    {
+        // results are in chunk order, one per cache line
+        poolstl::internal::chunk_job<int> job(&pool, 50);
+        for (int i = 0; i < 50; ++i) {
+            poolstl::internal::spawn_chunk(pool, job, i % 7 == 0, [i]() { return i * i; });
+        }
+        job.latch.wait();
+
+        REQUIRE(job.results.size() == 50);
+        int i = 0;
+        const int* prev = nullptr;
+        for (auto& res : job.results) {
+            REQUIRE(res == i * i);
+            REQUIRE((reinterpret_cast<std::uintptr_t>(&res) % 64) == 0);
+            if (prev) {
+                REQUIRE(reinterpret_cast<const char*>(&res) - reinterpret_cast<const char*>(prev) >= 64);
+            }
+            prev = &res;
+            ++i;
+        }
+    }
+
+    {
+        // the first exception is rethrown after all chunks finish
+        std::atomic<int> finished{0};
+        poolstl::internal::chunk_job<void> job(&pool, 20);
+        for (int i = 0; i < 20; ++i) {
+            poolstl::internal::spawn_chunk(pool, job, false, [i, &finished]() {
+                ++finished;
+                if (i % 5 == 0) {
+                    throw std::runtime_error("oops");
+                }
+            });
+        }
+        REQUIRE_THROWS_AS(job.latch.wait(), std::runtime_error);
+        REQUIRE(finished == 20);
+    }
+
+    {
+        // dropped chunk
+        poolstl::internal::chunk_job<void> job(&pool, 1);
+        pool.pause();
+        poolstl::internal::spawn_chunk(pool, job, false, []() {});
+        pool.clear_task_queue();
+        pool.unpause();
+        REQUIRE_THROWS_AS(job.latch.wait(), std::future_error);
+    }
+
+    {
+        // a batch of chunks keeps chunk order, after chunks spawned one at a time
+        poolstl::internal::chunk_job<int> job(&pool, 50);
+        poolstl::internal::spawn_chunk(pool, job, true, []() { return -1; });
+        poolstl::internal::spawn_chunks(pool, job, 49, [](std::size_t i) {
+            return [i]() { return (int)(i * i); };
+        });
+        job.latch.wait();
+
+        REQUIRE(job.results.size() == 50);
+        std::vector<int> results(job.results.begin(), job.results.end());
+        REQUIRE(results[0] == -1);
+        for (int i = 1; i < 50; ++i) {
+            REQUIRE(results[i] == (i - 1) * (i - 1));
+        }
+    }
+
+    {
+        // dropped batch
+        poolstl::internal::chunk_job<void> job(&pool, 10);
+        pool.pause();
+        poolstl::internal::spawn_chunks(pool, job, 10, [](std::size_t) { return []() {}; });
+        pool.clear_task_queue();
+        pool.unpause();
+        REQUIRE_THROWS_AS(job.latch.wait(), std::future_error);
+    }
+}
+
+TEST_CASE("submit_bulk", "[pool]") {
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        std::vector<std::atomic<int>> counts(1000);
+        for (auto& c : counts) {
+            c = 0;
+        }
+        pool.submit_bulk(counts.size(), [&counts](std::size_t i) { ++counts[i]; });
+        pool.submit_bulk(0, [&counts](std::size_t) { ++counts[0]; });
+        pool.wait_for_tasks();
+        for (auto& c : counts) {
+            REQUIRE(c == 1);
+        }
+
+        // submitted from a worker, to its own deque
+        std::atomic<int> sum{0};
+        pool.submit_detach([&]() { pool.submit_bulk(100, [&sum](std::size_t i) { sum += (int)i; }); });
+        pool.wait_for_tasks();
+        REQUIRE(sum == 4950);
+
+        // the shared Callable is destroyed once all tasks are done or dropped
+        auto token = std::make_shared<int>(0);
+        pool.pause();
+        pool.submit_bulk(10, [token](std::size_t) {});
+        REQUIRE(token.use_count() == 2);
+        pool.clear_task_queue();
+        REQUIRE(token.use_count() == 1);
+        pool.unpause();
+    }
+}
+
+TEST_CASE("help_while_waiting", "[pool]") {
+    {
+        // The calling thread can run queued tasks itself.
+        ttp::task_thread_pool pool(1);
+        std::promise<void> release_worker;
+        std::shared_future<void> worker_released = release_worker.get_future().share();
+        auto worker_busy = pool.submit([worker_released]() { worker_released.wait(); });
+        while (pool.get_num_running_tasks() == 0) {
+            std::this_thread::yield();
+        }
+
+        std::atomic<bool> ran{false};
+        pool.submit_detach([&ran]() { ran = true; });
+        while (!ran) {
+            pool.run_pending_task();
+        }
+        REQUIRE_FALSE(pool.run_pending_task());
+
+        release_worker.set_value();
+        worker_busy.get();
+
+        // Paused pools do not run tasks.
+        pool.pause();
+        pool.submit_detach([]() {});
+        REQUIRE_FALSE(pool.run_pending_task());
+        pool.unpause();
+    }
+
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        // Every worker waits on parallel algorithms that use the same pool.
+        std::vector<std::vector<int>> vecs(pool.get_num_threads() + 1);
+        std::vector<std::future<void>> futures;
+        for (auto& v : vecs) {
+            v = iota_vector(1000);
+            scramble(v);
+            futures.emplace_back(pool.submit([&pool, &v]() {
+                std::sort(poolstl::par.on(pool), v.begin(), v.end());
+            }));
+        }
+        poolstl::internal::get_futures(futures);
+
+        for (auto& v : vecs) {
+            REQUIRE(std::is_sorted(v.cbegin(), v.cend()));
+        }
+    }
+}
+
+TEST_CASE("nested", "[pool][execution]") {
+    REQUIRE(ttp::task_thread_pool::get_current_pool() == nullptr);
+    REQUIRE(poolstl::par.pool() == poolstl::execution::internal::get_default_pool().get());
+
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+
+        std::vector<std::vector<int>> groups(20);
+        for (auto& group : groups) {
+            group = iota_vector(101);
+            scramble(group);
+        }
+        std::vector<int> sums(groups.size());
+        std::atomic<bool> inherited_pool{true};
+
+        std::for_each(poolstl::par.on(pool), iota_iter<std::size_t>(0), iota_iter<std::size_t>(groups.size()),
+                      [&](std::size_t i) {
+            if (poolstl::par.pool() != &pool) {
+                inherited_pool = false;
+            }
+            std::sort(poolstl::par, groups[i].begin(), groups[i].end());
+            sums[i] = std::reduce(poolstl::par, groups[i].cbegin(), groups[i].cend());
+        });
+
+        REQUIRE(inherited_pool);
+        for (std::size_t i = 0; i < groups.size(); ++i) {
+            REQUIRE(std::is_sorted(groups[i].cbegin(), groups[i].cend()));
+            REQUIRE(sums[i] == 5050);
+        }
+    }
+
+    // changing the thread count during a nested call, from outside and from inside the pool
+    for (unsigned int num_threads : {1U, 2U, 4U}) {
+        ttp::task_thread_pool pool(num_threads);
+        std::atomic<bool> started{false};
+        std::atomic<int> count{0};
+        auto outer = pool.submit([&]() {
+            std::for_each(poolstl::par.on(pool).with_grain(1000), iota_iter<int>(0), iota_iter<int>(100000),
+                          [&](int i) {
+                started = true;
+                if (i == 50000) {
+                    pool.set_num_threads(pool.get_num_threads() + 1);
+                }
+                ++count;
+            });
+            pool.set_num_threads(1);
+        });
+        while (!started) {
+            std::this_thread::yield();
+        }
+        pool.set_num_threads(3);
+        pool.set_num_threads(1);
+        outer.get();
+        REQUIRE(count == 100000);
+        pool.set_num_threads(2);
+        REQUIRE(pool.get_num_threads() == 2);
+    }
+}
+
 TEST_CASE("default_pool", "[execution]") {
     std::vector<int> v = {0, 1, 2, 3, 4, 5};
     auto sum = std::reduce(poolstl::par, v.cbegin(), v.cend());
@@ -645,6 +2351,59 @@ TEST_CASE("execution_policies", "[execution]") {
     REQUIRE(1 == std::count(poolstl::par_if(true, pool), v.cbegin(), v.cend(), 5));
 }
 
+TEST_CASE("grain", "[execution]") {
+    {
+        ttp::task_thread_pool pool(4);
+        REQUIRE(poolstl::par.grain() == 0);
+        REQUIRE(poolstl::par.with_grain(10).on(pool).par_if(true).grain() == 10);
+
+        auto v = iota_vector(100);
+
+        // Ranges shorter than two grains run on the calling thread.
+        const auto caller = std::this_thread::get_id();
+        std::atomic<int> on_other_thread{0};
+        std::for_each(poolstl::par.on(pool).with_grain(51), v.cbegin(), v.cend(), [&](int) {
+            if (std::this_thread::get_id() != caller) {
+                ++on_other_thread;
+            }
+        });
+        REQUIRE(on_other_thread == 0);
+
+        // Chunks have at least `grain` elements.
+        for (int grain : {1, 10, 30, 99, 100, 1000}) {
+            std::atomic<int> num_chunks{0};
+            poolstl::for_each_chunk(poolstl::par.on(pool).with_grain(grain), v.cbegin(), v.cend(),
+                                    [&]() { ++num_chunks; return 0; }, [](int, int) {});
+            REQUIRE(num_chunks == std::max(1, std::min(4, 100 / grain)));
+        }
+    }
+
+    // A grain of 1 splits even small ranges, so exercise the multi-chunk paths.
+    for (auto num_threads : test_thread_counts) {
+        ttp::task_thread_pool pool(num_threads);
+        auto policy = poolstl::par.on(pool).with_grain(1);
+
+        for (auto num_iters : test_arr_sizes) {
+            auto v = iota_vector(num_iters);
+            auto pred = [](int x) { return x % 3 == 0; };
+
+            REQUIRE(std::count_if(policy, v.cbegin(), v.cend(), pred) == std::count_if(v.cbegin(), v.cend(), pred));
+            REQUIRE(std::find(policy, v.cbegin(), v.cend(), num_iters / 2) ==
+                    std::find(v.cbegin(), v.cend(), num_iters / 2));
+
+            std::vector<int> dest1(v.size());
+            std::vector<int> dest2(v.size());
+            std::transform(v.cbegin(), v.cend(), dest1.begin(), [](int x) { return 2*x; });
+            std::transform(policy, v.cbegin(), v.cend(), dest2.begin(), [](int x) { return 2*x; });
+            REQUIRE(dest1 == dest2);
+
+            std::transform(v.cbegin(), v.cend(), dest1.cbegin(), dest1.begin(), std::plus<int>());
+            std::transform(policy, v.cbegin(), v.cend(), dest2.cbegin(), dest2.begin(), std::plus<int>());
+            REQUIRE(dest1 == dest2);
+        }
+    }
+}
+
 TEST_CASE("iota_iter(use)", "[iterator]") {
     REQUIRE(15 == std::reduce(poolstl::par, iota_iter<int>(0), iota_iter<int>(6)));
     REQUIRE(1 == std::count(poolstl::par, iota_iter<int>(0), iota_iter<int>(6), 5));